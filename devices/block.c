@@ -2,8 +2,10 @@
 #include <list.h>
 #include <string.h>
 #include <stdio.h>
+#include <tsc.h>
 #include "devices/ide.h"
 #include "threads/malloc.h"
+#include "threads/stats.h"
 
 /* A block device. */
 struct block
@@ -120,8 +122,12 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
+  uint64_t start;
+
   check_sector (block, sector);
+  start = rdtsc ();
   block->ops->read (block->aux, sector, buffer);
+  stat_record (STAT_HIST_BLOCK_READ, rdtsc () - start);
   block->read_cnt++;
 }
 
@@ -133,9 +139,13 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
+  uint64_t start;
+
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
+  start = rdtsc ();
   block->ops->write (block->aux, sector, buffer);
+  stat_record (STAT_HIST_BLOCK_WRITE, rdtsc () - start);
   block->write_cnt++;
 }
 
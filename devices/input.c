@@ -41,6 +41,44 @@ input_getc (void)
   return key;
 }
 
+/* Retrieves a key from the input buffer into *KEY without
+   waiting.  Returns false if no key was available. */
+bool
+input_try_getc (uint8_t *key) 
+{
+  enum intr_level old_level;
+  bool got_key = false;
+
+  old_level = intr_disable ();
+  if (!intq_empty (&buffer)) 
+    {
+      *key = intq_getc (&buffer);
+      serial_notify ();
+      got_key = true;
+    }
+  intr_set_level (old_level);
+
+  return got_key;
+}
+
+/* Returns true if a key is waiting in the input buffer.  If E is
+   non-null, first adds it to the buffer's poll queue, so that P
+   will be woken when a key arrives. */
+bool
+input_poll (struct pollq_entry *e, struct poller *p) 
+{
+  enum intr_level old_level;
+  bool ready;
+
+  old_level = intr_disable ();
+  if (e != NULL)
+    pollq_add (&buffer.pollers, e, p);
+  ready = !intq_empty (&buffer);
+  intr_set_level (old_level);
+
+  return ready;
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
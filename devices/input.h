@@ -4,9 +4,14 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+struct poller;
+struct pollq_entry;
+
 void input_init (void);
 void input_putc (uint8_t);
 uint8_t input_getc (void);
+bool input_try_getc (uint8_t *);
 bool input_full (void);
+bool input_poll (struct pollq_entry *, struct poller *);
 
 #endif /* devices/input.h */
@@ -12,6 +12,7 @@ intq_init (struct intq *q)
 {
   lock_init (&q->lock);
   q->not_full = q->not_empty = NULL;
+  pollq_init (&q->pollers);
   q->head = q->tail = 0;
 }
 
@@ -72,6 +73,7 @@ intq_putc (struct intq *q, uint8_t byte)
   q->buf[q->head] = byte;
   q->head = next (q->head);
   signal (q, &q->not_empty);
+  pollq_wake (&q->pollers);
 }
 
 /* Returns the position after POS within an intq. */
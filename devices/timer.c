@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
   
@@ -21,7 +22,8 @@
 static int64_t ticks;
 
 /* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
+   Initialized by timer_calibrate(), unless given beforehand to
+   timer_set_calibration(). */
 static unsigned loops_per_tick;
 
 static intr_handler_func timer_interrupt;
@@ -46,6 +48,12 @@ timer_calibrate (void)
   unsigned high_bit, test_bit;
 
   ASSERT (intr_get_level () == INTR_ON);
+  if (loops_per_tick != 0) 
+    {
+      printf ("Timer calibration given: %'"PRIu64" loops/s.\n",
+              (uint64_t) loops_per_tick * TIMER_FREQ);
+      return;
+    }
   printf ("Calibrating timer...  ");
 
   /* Approximate loops_per_tick as the largest power-of-two
@@ -63,7 +71,17 @@ timer_calibrate (void)
     if (!too_many_loops (high_bit | test_bit))
       loops_per_tick |= test_bit;
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  printf ("%'"PRIu64" loops/s (-lpt=%u).\n",
+          (uint64_t) loops_per_tick * TIMER_FREQ, loops_per_tick);
+}
+
+/* Sets loops_per_tick to LOOPS, as found by timer_calibrate() on
+   an earlier boot on the same machine, so that timer_calibrate()
+   need not busy-wait for it again. */
+void
+timer_set_calibration (unsigned loops) 
+{
+  loops_per_tick = loops;
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -168,9 +186,11 @@ timer_print_stats (void)
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
   ticks++;
+  if (profile_enabled)
+    profile_sample (args);
   thread_tick ();
 }
 
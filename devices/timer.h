@@ -9,6 +9,7 @@
 
 void timer_init (void);
 void timer_calibrate (void);
+void timer_set_calibration (unsigned loops_per_tick);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
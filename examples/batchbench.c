@@ -0,0 +1,99 @@
+/* batchbench.c
+
+   Times many small seek+read pairs made with one trap per call
+   against the same pairs submitted through SYS_BATCH. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include <tsc.h>
+
+#define FILE_NAME "batchbench.tmp"
+#define FILE_SIZE 512
+#define PAIR_CNT 2000
+
+static int open_test_file (void);
+
+int
+main (void) 
+{
+  static struct batch b;
+  char trap_bytes[PAIR_CNT], batch_bytes[PAIR_CNT];
+  uint64_t start, trap_cycles, batch_cycles;
+  int read_idx[BATCH_SIZE / 2];
+  int fd, i;
+
+  fd = open_test_file ();
+  if (fd < 0)
+    return EXIT_FAILURE;
+
+  start = rdtsc ();
+  for (i = 0; i < PAIR_CNT; i++) 
+    {
+      seek (fd, i % FILE_SIZE);
+      read (fd, &trap_bytes[i], 1);
+    }
+  trap_cycles = rdtsc () - start;
+
+  batch_init (&b);
+  start = rdtsc ();
+  for (i = 0; i < PAIR_CNT; i += BATCH_SIZE / 2) 
+    {
+      int j;
+
+      for (j = 0; j < BATCH_SIZE / 2 && i + j < PAIR_CNT; j++) 
+        {
+          batch_add (&b, SYS_SEEK, fd, (i + j) % FILE_SIZE, 0);
+          read_idx[j] = batch_add (&b, SYS_READ, fd,
+                                   (unsigned) &batch_bytes[i + j], 1);
+        }
+      batch_submit (&b);
+      while (j-- > 0)
+        if (batch_result (&b, read_idx[j]) != 1)
+          {
+            printf ("batchbench: batched read %d failed\n", i + j);
+            return EXIT_FAILURE;
+          }
+    }
+  batch_cycles = rdtsc () - start;
+
+  close (fd);
+  remove (FILE_NAME);
+
+  for (i = 0; i < PAIR_CNT; i++)
+    if (trap_bytes[i] != batch_bytes[i]) 
+      {
+        printf ("batchbench: byte %d differs\n", i);
+        return EXIT_FAILURE;
+      }
+
+  printf ("%d seek+read pairs, one trap per call: %llu cycles per pair\n",
+          PAIR_CNT, trap_cycles / PAIR_CNT);
+  printf ("%d seek+read pairs, %d calls per trap: %llu cycles per pair\n",
+          PAIR_CNT, BATCH_SIZE, batch_cycles / PAIR_CNT);
+  return EXIT_SUCCESS;
+}
+
+/* Creates the test file, fills it with a byte pattern, and
+   returns an open file descriptor for it, or -1 on failure. */
+static int
+open_test_file (void) 
+{
+  char buf[FILE_SIZE];
+  int fd, i;
+
+  for (i = 0; i < FILE_SIZE; i++)
+    buf[i] = i * 13;
+
+  remove (FILE_NAME);
+  if (!create (FILE_NAME, FILE_SIZE) || (fd = open (FILE_NAME)) < 0) 
+    {
+      printf ("batchbench: could not create %s\n", FILE_NAME);
+      return -1;
+    }
+  if (write (fd, buf, FILE_SIZE) != FILE_SIZE) 
+    {
+      printf ("batchbench: could not write %s\n", FILE_NAME);
+      return -1;
+    }
+  return fd;
+}
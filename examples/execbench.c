@@ -0,0 +1,48 @@
+/* execbench.c
+
+   Times exec() latency, like recursor but flat: starts itself
+   with a depth of 0 many times in a row, waiting for each child,
+   and reports the cycles taken by the first exec(), before the
+   executable's headers and text are cached, and the average over
+   the rest. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include <tsc.h>
+
+#define EXEC_CNT 50
+
+int
+main (int argc, char *argv[])
+{
+  uint64_t start, first, rest;
+  pid_t pid;
+  int i;
+
+  /* Child: exit at once. */
+  if (argc > 1 && atoi (argv[1]) == 0)
+    return EXIT_SUCCESS;
+
+  first = rest = 0;
+  for (i = 0; i < EXEC_CNT; i++)
+    {
+      start = rdtsc ();
+      pid = exec ("execbench 0");
+      if (pid == PID_ERROR)
+        {
+          printf ("execbench: exec failed\n");
+          return EXIT_FAILURE;
+        }
+      wait (pid);
+      if (i == 0)
+        first = rdtsc () - start;
+      else
+        rest += rdtsc () - start;
+    }
+
+  printf ("execbench: first exec+wait %llu cycles\n", first);
+  printf ("execbench: later exec+wait %llu cycles each (%d runs)\n",
+          rest / (EXEC_CNT - 1), EXEC_CNT - 1);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+/* fdbench.c
+
+   Opens one file 10,000 times, keeping every descriptor open, and
+   then closes them all, reporting the cycles per open() and
+   close().  Finally closes and reopens descriptors scattered
+   through the table to time the reuse of freed descriptors. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include <tsc.h>
+
+#define FILE_NAME "fdbench.tmp"
+#define FD_CNT 10000
+#define REUSE_CNT 1000
+
+static int fds[FD_CNT];
+
+int
+main (void) 
+{
+  uint64_t start;
+  int i;
+
+  remove (FILE_NAME);
+  if (!create (FILE_NAME, 0)) 
+    {
+      printf ("fdbench: could not create %s\n", FILE_NAME);
+      return EXIT_FAILURE;
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < FD_CNT; i++) 
+    {
+      fds[i] = open (FILE_NAME);
+      if (fds[i] < 0) 
+        {
+          printf ("fdbench: open %d failed\n", i);
+          return EXIT_FAILURE;
+        }
+    }
+  printf ("%d opens: %llu cycles per open\n",
+          FD_CNT, (rdtsc () - start) / FD_CNT);
+
+  start = rdtsc ();
+  for (i = 0; i < REUSE_CNT; i++) 
+    {
+      int slot = (i * 7919) % FD_CNT;
+      int fd = fds[slot];
+
+      close (fd);
+      fds[slot] = open (FILE_NAME);
+      if (fds[slot] != fd) 
+        {
+          printf ("fdbench: reopen got fd %d instead of %d\n",
+                  fds[slot], fd);
+          return EXIT_FAILURE;
+        }
+    }
+  printf ("%d close+reopen pairs: %llu cycles per pair\n",
+          REUSE_CNT, (rdtsc () - start) / REUSE_CNT);
+
+  start = rdtsc ();
+  for (i = 0; i < FD_CNT; i++)
+    close (fds[i]);
+  printf ("%d closes: %llu cycles per close\n",
+          FD_CNT, (rdtsc () - start) / FD_CNT);
+
+  remove (FILE_NAME);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+/* pingpong.c
+
+   Times switches between two processes: starts a copy of itself
+   connected by a pair of pipes and bounces one byte back and
+   forth between them, reporting the cycles per round trip.  Each
+   round trip blocks and wakes each process once, so it costs two
+   process switches, two page directory loads included. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include <tsc.h>
+
+#define ROUND_CNT 10000
+
+/* Child: echoes every byte read from fd IN to fd OUT until IN
+   reaches end of file. */
+static int
+echo (int in, int out)
+{
+  char c;
+
+  while (read (in, &c, 1) == 1)
+    if (write (out, &c, 1) != 1)
+      return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int ping[2], pong[2];
+  char cmd[32];
+  uint64_t start;
+  pid_t pid;
+  char c = 'x';
+  int i;
+
+  if (argc == 3)
+    return echo (atoi (argv[1]), atoi (argv[2]));
+
+  if (pipe (ping) < 0 || pipe (pong) < 0)
+    {
+      printf ("pingpong: pipe failed\n");
+      return EXIT_FAILURE;
+    }
+  snprintf (cmd, sizeof cmd, "pingpong %d %d", ping[0], pong[1]);
+  pid = exec (cmd);
+  if (pid == PID_ERROR)
+    {
+      printf ("pingpong: exec failed\n");
+      return EXIT_FAILURE;
+    }
+  close (ping[0]);
+  close (pong[1]);
+
+  start = rdtsc ();
+  for (i = 0; i < ROUND_CNT; i++)
+    if (write (ping[1], &c, 1) != 1 || read (pong[0], &c, 1) != 1)
+      {
+        printf ("pingpong: round trip %d failed\n", i);
+        return EXIT_FAILURE;
+      }
+  printf ("pingpong: %d round trips, %llu cycles each\n",
+          ROUND_CNT, (rdtsc () - start) / ROUND_CNT);
+
+  close (ping[1]);
+  close (pong[0]);
+  wait (pid);
+  return EXIT_SUCCESS;
+}
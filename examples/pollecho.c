@@ -0,0 +1,81 @@
+/* pollecho.c
+
+   Exercises pipes, O_NONBLOCK, and poll().  First fills a
+   non-blocking pipe to find its capacity.  Then waits on the
+   console and the pipe at once: each line typed is written into
+   the pipe, and whatever comes out of the pipe is echoed back in
+   upper case.  Typing a line that starts with `q' closes the
+   writing end, and the program exits when poll() reports that the
+   pipe has hung up. */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <syscall.h>
+
+int
+main (void)
+{
+  struct pollfd fds[2];
+  char buf[128];
+  int pipefd[2];
+  int capacity, n, i;
+
+  if (pipe (pipefd) < 0)
+    {
+      printf ("pollecho: pipe failed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Find the pipe's capacity, then drain it again. */
+  fcntl (pipefd[0], F_SETFL, O_NONBLOCK);
+  fcntl (pipefd[1], F_SETFL, O_NONBLOCK);
+  capacity = 0;
+  while ((n = write (pipefd[1], buf, sizeof buf)) > 0)
+    capacity += n;
+  while (read (pipefd[0], buf, sizeof buf) > 0)
+    continue;
+  printf ("pollecho: pipe holds %d bytes\n", capacity);
+
+  fds[0].fd = STDIN_FILENO;
+  fds[0].events = POLLIN;
+  fds[1].fd = pipefd[0];
+  fds[1].events = POLLIN;
+  for (;;)
+    {
+      if (poll (fds, 2, -1) < 0)
+        {
+          printf ("pollecho: poll failed\n");
+          return EXIT_FAILURE;
+        }
+
+      if (fds[0].revents & POLLIN)
+        {
+          n = read (STDIN_FILENO, buf, sizeof buf);
+          for (i = 0; i < n; i++)
+            if (buf[i] == '\r')
+              buf[i] = '\n';
+          if (n > 0 && buf[0] == 'q' && pipefd[1] >= 0)
+            {
+              close (pipefd[1]);
+              pipefd[1] = -1;
+              fds[0].fd = -1;
+            }
+          else if (n > 0 && pipefd[1] >= 0)
+            write (pipefd[1], buf, n);
+        }
+
+      if (fds[1].revents & POLLIN)
+        {
+          n = read (pipefd[0], buf, sizeof buf);
+          for (i = 0; i < n; i++)
+            buf[i] = toupper ((unsigned char) buf[i]);
+          if (n > 0)
+            write (STDOUT_FILENO, buf, n);
+        }
+      else if (fds[1].revents & POLLHUP)
+        break;
+    }
+
+  printf ("pollecho: pipe closed\n");
+  return EXIT_SUCCESS;
+}
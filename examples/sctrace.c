@@ -0,0 +1,150 @@
+/* sctrace.c
+
+   Drains the kernel's system call trace and prints one line per
+   call: its sequence number, thread, name and arguments, return
+   value, and the cycles it took, followed by the count, total
+   and longest cycles of each system call seen.  Given a command,
+   first discards the trace, then runs the command and waits for
+   it, so that what is printed is what happened while it ran,
+   e.g. "sctrace cat echo.c" shows where cat's read and write time
+   went.  Calls made by anything else running at the same time
+   are included. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Events read per system call. */
+#define EVENT_CNT 64
+
+/* Calls summarized separately. */
+#define NR_MAX 64
+
+static struct syscall_event events[EVENT_CNT];
+
+/* Per-call totals. */
+static struct
+  {
+    int cnt;
+    unsigned long long cycles;
+    unsigned long long max_cycles;
+  }
+totals[NR_MAX];
+
+static const char *names[NR_MAX] =
+  {
+    [SYS_HALT] = "halt", [SYS_EXIT] = "exit", [SYS_EXEC] = "exec",
+    [SYS_WAIT] = "wait", [SYS_CREATE] = "create",
+    [SYS_REMOVE] = "remove", [SYS_OPEN] = "open",
+    [SYS_FILESIZE] = "filesize", [SYS_READ] = "read",
+    [SYS_WRITE] = "write", [SYS_SEEK] = "seek", [SYS_TELL] = "tell",
+    [SYS_CLOSE] = "close", [SYS_MMAP] = "mmap",
+    [SYS_MUNMAP] = "munmap", [SYS_CHDIR] = "chdir",
+    [SYS_MKDIR] = "mkdir", [SYS_READDIR] = "readdir",
+    [SYS_ISDIR] = "isdir", [SYS_INUMBER] = "inumber",
+    [SYS_BATCH] = "batch", [SYS_PIPE] = "pipe", [SYS_POLL] = "poll",
+    [SYS_FCNTL] = "fcntl", [SYS_DUP] = "dup", [SYS_DUP2] = "dup2",
+    [SYS_STATS] = "stats", [SYS_TRACE] = "trace",
+  };
+
+static void discard (void);
+static void print_trace (void);
+static void print_totals (void);
+
+int
+main (int argc, char *argv[])
+{
+  char cmd[128];
+  pid_t pid;
+  int i;
+
+  if (argc > 1)
+    {
+      /* Rebuild the command line from the arguments. */
+      cmd[0] = '\0';
+      for (i = 1; i < argc; i++)
+        {
+          if (i > 1)
+            strlcat (cmd, " ", sizeof cmd);
+          strlcat (cmd, argv[i], sizeof cmd);
+        }
+
+      discard ();
+      pid = exec (cmd);
+      if (pid == PID_ERROR)
+        {
+          printf ("sctrace: exec failed\n");
+          return EXIT_FAILURE;
+        }
+      wait (pid);
+    }
+
+  print_trace ();
+  print_totals ();
+  return EXIT_SUCCESS;
+}
+
+/* Drains the trace without printing it. */
+static void
+discard (void)
+{
+  while (syscall_trace (events, EVENT_CNT) > 0)
+    continue;
+}
+
+/* Drains the trace, printing each event and adding it to the
+   totals.  Events are read into a buffer before any is printed,
+   because printing makes system calls of its own. */
+static void
+print_trace (void)
+{
+  bool first = true;
+  unsigned next_seq = 0;
+  int cnt, i;
+
+  while ((cnt = syscall_trace (events, EVENT_CNT)) > 0)
+    for (i = 0; i < cnt; i++)
+      {
+        const struct syscall_event *e = &events[i];
+
+        if (!first && e->seq != next_seq)
+          printf ("... %u events lost\n", e->seq - next_seq);
+        first = false;
+        next_seq = e->seq + 1;
+
+        if (e->nr >= 0 && e->nr < NR_MAX && names[e->nr] != NULL)
+          printf ("%u %d %s", e->seq, e->tid, names[e->nr]);
+        else
+          printf ("%u %d %d", e->seq, e->tid, e->nr);
+        printf ("(%#x, %#x, %#x) = %d %llu cycles\n",
+                e->args[0], e->args[1], e->args[2], e->result, e->cycles);
+
+        if (e->nr >= 0 && e->nr < NR_MAX)
+          {
+            totals[e->nr].cnt++;
+            totals[e->nr].cycles += e->cycles;
+            if (e->cycles > totals[e->nr].max_cycles)
+              totals[e->nr].max_cycles = e->cycles;
+          }
+      }
+}
+
+/* Prints the totals of every call seen. */
+static void
+print_totals (void)
+{
+  int nr;
+
+  printf ("%-10s %8s %14s %14s\n", "call", "count", "cycles", "max");
+  for (nr = 0; nr < NR_MAX; nr++)
+    if (totals[nr].cnt != 0)
+      {
+        if (names[nr] != NULL)
+          printf ("%-10s", names[nr]);
+        else
+          printf ("%-10d", nr);
+        printf (" %8d %14llu %14llu\n", totals[nr].cnt, totals[nr].cycles,
+                totals[nr].max_cycles);
+      }
+}
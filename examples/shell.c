@@ -3,8 +3,13 @@
 #include <string.h>
 #include <syscall.h>
 
+/* Most programs in one pipeline. */
+#define MAX_STAGES 8
+
 static void read_line (char line[], size_t);
 static bool backspace (char **pos, char line[]);
+static void run_pipeline (char *command);
+static char *trim (char *);
 
 int
 main (void)
@@ -31,19 +36,105 @@ main (void)
           /* Empty command. */
         }
       else
-        {
-          pid_t pid = exec (command);
-          if (pid != PID_ERROR)
-            printf ("\"%s\": exit code %d\n", command, wait (pid));
-          else
-            printf ("exec failed\n");
-        }
+        run_pipeline (command);
     }
 
   printf ("Shell exiting.");
   return EXIT_SUCCESS;
 }
 
+/* Runs COMMAND, which may be several programs separated by `|',
+   connecting each one's standard output to the next one's standard
+   input by a pipe, then waits for all of them.  The children
+   inherit the shell's descriptors, so each is started with the
+   right pipe ends moved onto descriptors 0 and 1 and with every
+   other pipe end marked O_CLOEXEC; otherwise a reader would hold
+   its own pipe's writing end open and never see end of file. */
+static void
+run_pipeline (char *command) 
+{
+  char *stages[MAX_STAGES];
+  pid_t pids[MAX_STAGES];
+  int stage_cnt = 0;
+  int saved_in, saved_out;
+  int prev_read = -1;
+  char *stage, *save_ptr;
+  int i;
+
+  for (stage = strtok_r (command, "|", &save_ptr); stage != NULL;
+       stage = strtok_r (NULL, "|", &save_ptr)) 
+    {
+      if (stage_cnt == MAX_STAGES) 
+        {
+          printf ("at most %d programs in a pipeline\n", MAX_STAGES);
+          return;
+        }
+      stages[stage_cnt++] = trim (stage);
+    }
+
+  saved_in = dup (STDIN_FILENO);
+  saved_out = dup (STDOUT_FILENO);
+  fcntl (saved_in, F_SETFL, O_CLOEXEC);
+  fcntl (saved_out, F_SETFL, O_CLOEXEC);
+
+  for (i = 0; i < stage_cnt; i++) 
+    {
+      int p[2] = {-1, -1};
+
+      if (i + 1 < stage_cnt) 
+        {
+          if (pipe (p) < 0) 
+            {
+              printf ("pipe failed\n");
+              break;
+            }
+          fcntl (p[0], F_SETFL, O_CLOEXEC);
+          fcntl (p[1], F_SETFL, O_CLOEXEC);
+        }
+
+      if (prev_read >= 0)
+        dup2 (prev_read, STDIN_FILENO);
+      if (p[1] >= 0)
+        dup2 (p[1], STDOUT_FILENO);
+      pids[i] = exec (stages[i]);
+      dup2 (saved_in, STDIN_FILENO);
+      dup2 (saved_out, STDOUT_FILENO);
+
+      if (prev_read >= 0)
+        close (prev_read);
+      if (p[1] >= 0)
+        close (p[1]);
+      prev_read = p[0];
+
+      if (pids[i] == PID_ERROR)
+        printf ("\"%s\": exec failed\n", stages[i]);
+    }
+  if (prev_read >= 0)
+    close (prev_read);
+  close (saved_in);
+  close (saved_out);
+
+  stage_cnt = i;
+  for (i = 0; i < stage_cnt; i++)
+    if (pids[i] != PID_ERROR)
+      printf ("\"%s\": exit code %d\n", stages[i], wait (pids[i]));
+}
+
+/* Strips leading and trailing spaces from S in place and returns
+   the first character that is left. */
+static char *
+trim (char *s) 
+{
+  char *end;
+
+  while (*s == ' ')
+    s++;
+  end = s + strlen (s);
+  while (end > s && end[-1] == ' ')
+    *--end = '\0';
+  return s;
+}
+
 /* Reads a line of input from the user into LINE, which has room
    for SIZE bytes.  Handles backspace and Ctrl+U in the ways
    expected by Unix users.  On return, LINE will always be
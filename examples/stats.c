@@ -0,0 +1,122 @@
+/* stats.c
+
+   Prints the kernel's performance counters.  Given a command,
+   runs it and prints how much each counter changed while it ran
+   instead, e.g. "stats matmult" shows the page faults, swapping
+   and system calls that matmult caused, along with anything else
+   that was running at the time. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define BUF_SIZE 4096
+
+static char before[BUF_SIZE], after[BUF_SIZE];
+
+static void print_changes (void);
+static bool find_counter (const char *name, size_t len, long long *value);
+static long long parse_value (const char *);
+
+int
+main (int argc, char *argv[])
+{
+  char cmd[128];
+  pid_t pid;
+  int i;
+
+  if (argc < 2)
+    {
+      if (stats (after, sizeof after) < 0)
+        return EXIT_FAILURE;
+      printf ("%s", after);
+      return EXIT_SUCCESS;
+    }
+
+  /* Rebuild the command line from the arguments. */
+  cmd[0] = '\0';
+  for (i = 1; i < argc; i++)
+    {
+      if (i > 1)
+        strlcat (cmd, " ", sizeof cmd);
+      strlcat (cmd, argv[i], sizeof cmd);
+    }
+
+  stats (before, sizeof before);
+  pid = exec (cmd);
+  if (pid == PID_ERROR)
+    {
+      printf ("stats: exec failed\n");
+      return EXIT_FAILURE;
+    }
+  wait (pid);
+  stats (after, sizeof after);
+
+  print_changes ();
+  return EXIT_SUCCESS;
+}
+
+/* Prints each "NAME VALUE" line of AFTER whose value differs from
+   that of the same counter in BEFORE, as the difference, and
+   every histogram line in full. */
+static void
+print_changes (void)
+{
+  char *line, *save_ptr;
+
+  for (line = strtok_r (after, "\n", &save_ptr); line != NULL;
+       line = strtok_r (NULL, "\n", &save_ptr))
+    {
+      char *space = strchr (line, ' ');
+      long long old_value = 0;
+
+      if (space == NULL)
+        continue;
+      if (strchr (space, '=') != NULL)
+        {
+          printf ("%s\n", line);
+          continue;
+        }
+      find_counter (line, space - line, &old_value);
+      if (parse_value (space + 1) != old_value)
+        printf ("%.*s %lld\n", (int) (space - line), line,
+                parse_value (space + 1) - old_value);
+    }
+}
+
+/* Looks for the counter whose name is the LEN bytes at NAME in
+   BEFORE, storing its value in *VALUE if found. */
+static bool
+find_counter (const char *name, size_t len, long long *value)
+{
+  const char *p = before;
+
+  while (*p != '\0')
+    {
+      if (!memcmp (p, name, len) && p[len] == ' ')
+        {
+          *value = parse_value (p + len + 1);
+          return true;
+        }
+      p = strchr (p, '\n');
+      if (p == NULL)
+        break;
+      p++;
+    }
+  return false;
+}
+
+/* Returns the decimal number at the start of S. */
+static long long
+parse_value (const char *s)
+{
+  long long value = 0;
+  bool negative = *s == '-';
+
+  if (negative)
+    s++;
+  for (; *s >= '0' && *s <= '9'; s++)
+    value = value * 10 + (*s - '0');
+  return negative ? -value : value;
+}
@@ -6,6 +6,12 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#ifdef USERPROG
+#include "userprog/elfcache.h"
+#endif
+#ifdef VM
+#include "vm/pagecache.h"
+#endif
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -176,6 +182,12 @@ inode_close (struct inode *inode)
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
+#ifdef USERPROG
+          elf_cache_invalidate (inode->sector);
+#endif
+#ifdef VM
+          page_cache_invalidate (inode->sector);
+#endif
           free_map_release (inode->sector, 1);
           free_map_release (inode->data.start,
                             bytes_to_sectors (inode->data.length)); 
@@ -265,6 +277,14 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   if (inode->deny_write_cnt)
     return 0;
 
+  /* Anything cached from this file is about to go stale. */
+#ifdef USERPROG
+  elf_cache_invalidate (inode->sector);
+#endif
+#ifdef VM
+  page_cache_invalidate (inode->sector);
+#endif
+
   while (size > 0) 
     {
       /* Sector to write, starting byte offset within sector. */
@@ -27,6 +27,7 @@ typedef unsigned long elem_type;
 struct bitmap
   {
     size_t bit_cnt;     /* Number of bits. */
+    size_t hint;        /* Every bit before this one is true. */
     elem_type *bits;    /* Elements that represent bits. */
   };
 
@@ -68,6 +69,37 @@ last_mask (const struct bitmap *b)
   int last_bits = b->bit_cnt % ELEM_BITS;
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
+
+/* Returns the index of the first bit in B between START and END,
+   exclusive, that is set to VALUE, or END if there is none.
+   Skips a whole element at a time where it can. */
+static size_t
+find_next (const struct bitmap *b, size_t start, size_t end, bool value) 
+{
+  elem_type flip = value ? 0 : (elem_type) -1;
+  size_t idx, last_idx, bit_idx;
+  elem_type elem;
+
+  if (start >= end)
+    return end;
+
+  /* Turn the bits we are looking for into 1s, and discard those
+     before START in its element. */
+  idx = elem_idx (start);
+  last_idx = elem_idx (end - 1);
+  elem = (b->bits[idx] ^ flip) & ~(bit_mask (start) - 1);
+  while (elem == 0) 
+    {
+      if (idx == last_idx)
+        return end;
+      elem = b->bits[++idx] ^ flip;
+    }
+
+  /* BSF finds the lowest 1 bit.  See [IA32-v2a] "BSF--Bit Scan
+     Forward". */
+  bit_idx = idx * ELEM_BITS + __builtin_ctzl (elem);
+  return bit_idx < end ? bit_idx : end;
+}
 
 /* Creation and destruction. */
 
@@ -82,6 +114,7 @@ bitmap_create (size_t bit_cnt)
   if (b != NULL)
     {
       b->bit_cnt = bit_cnt;
+      b->hint = 0;
       b->bits = malloc (byte_cnt (bit_cnt));
       if (b->bits != NULL || bit_cnt == 0)
         {
@@ -104,6 +137,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
   ASSERT (block_size >= bitmap_buf_size (bit_cnt));
 
   b->bit_cnt = bit_cnt;
+  b->hint = 0;
   b->bits = (elem_type *) (b + 1);
   bitmap_set_all (b, false);
   return b;
@@ -172,6 +206,9 @@ bitmap_reset (struct bitmap *b, size_t bit_idx)
   size_t idx = elem_idx (bit_idx);
   elem_type mask = bit_mask (bit_idx);
 
+  if (bit_idx < b->hint)
+    b->hint = bit_idx;
+
   /* This is equivalent to `b->bits[idx] &= ~mask' except that it
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the AND instruction in [IA32-v2a]. */
@@ -187,6 +224,9 @@ bitmap_flip (struct bitmap *b, size_t bit_idx)
   size_t idx = elem_idx (bit_idx);
   elem_type mask = bit_mask (bit_idx);
 
+  if (bit_idx < b->hint)
+    b->hint = bit_idx;
+
   /* This is equivalent to `b->bits[idx] ^= mask' except that it
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the XOR instruction in [IA32-v2b]. */
@@ -213,18 +253,27 @@ bitmap_set_all (struct bitmap *b, bool value)
   bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Whole elements in the middle of the range are stored at once. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
+  size_t end = start + cnt;
   size_t i;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  if (!value && cnt > 0 && start < b->hint)
+    b->hint = start;
+
+  for (i = start; i < end && i % ELEM_BITS != 0; i++)
+    bitmap_set (b, i, value);
+  for (; i + ELEM_BITS <= end; i += ELEM_BITS)
+    b->bits[elem_idx (i)] = value ? (elem_type) -1 : 0;
+  for (; i < end; i++)
+    bitmap_set (b, i, value);
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -250,16 +299,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return find_next (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -288,6 +332,39 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 
 /* Finding set or unset bits. */
 
+/* Finds and returns the starting index of the first group of CNT
+   consecutive bits in B at or after START that are all set to
+   VALUE, as bitmap_scan(), and stores in *FIRST the index of the
+   first bit at or after START set to VALUE, or B's size if there
+   is none.
+
+   Rather than testing every possible start, jumps from each run
+   of bits set to VALUE to the next, so a scan costs time in
+   proportion to the number of runs and of elements it passes. */
+static size_t
+scan (const struct bitmap *b, size_t start, size_t cnt, bool value,
+      size_t *first) 
+{
+  size_t i = start;
+
+  /* Bits before the hint are all true. */
+  if (!value && i < b->hint)
+    i = b->hint;
+
+  i = *first = find_next (b, i, b->bit_cnt, value);
+  if (cnt == 0)
+    return start;
+  while (cnt <= b->bit_cnt - i) 
+    {
+      /* Bits I through END - 1 are set to VALUE. */
+      size_t end = find_next (b, i, i + cnt, !value);
+      if (end == i + cnt)
+        return i;
+      i = find_next (b, end, b->bit_cnt, value);
+    }
+  return BITMAP_ERROR;
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
@@ -295,18 +372,12 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
+  size_t first;
+
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
-    {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
-    }
-  return BITMAP_ERROR;
+  return scan (b, start, cnt, value, &first);
 }
 
 /* Finds the first group of CNT consecutive bits in B at or after
@@ -319,9 +390,25 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value)
 {
-  size_t idx = bitmap_scan (b, start, cnt, value);
+  size_t first;
+  size_t idx;
+
+  ASSERT (b != NULL);
+  ASSERT (start <= b->bit_cnt);
+
+  idx = scan (b, start, cnt, value, &first);
+
+  /* A scan for false bits that began at the hint found the first
+     false bit, so every bit before it is true. */
+  if (!value && start <= b->hint)
+    b->hint = first;
+
   if (idx != BITMAP_ERROR) 
-    bitmap_set_multiple (b, idx, cnt, !value);
+    {
+      bitmap_set_multiple (b, idx, cnt, !value);
+      if (!value && idx == b->hint)
+        b->hint = idx + cnt;
+    }
   return idx;
 }
 
@@ -346,6 +433,7 @@ bitmap_read (struct bitmap *b, struct file *file)
       off_t size = byte_cnt (b->bit_cnt);
       success = file_read_at (file, b->bits, size, 0) == size;
       b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+      b->hint = 0;
     }
   return success;
 }
@@ -15,8 +15,11 @@
 static struct list *find_bucket (struct hash *, struct hash_elem *);
 static struct hash_elem *find_elem (struct hash *, struct list *,
                                     struct hash_elem *);
+static struct hash_elem *find_any (struct hash *, struct hash_elem *);
+static struct list *next_bucket (struct hash *, struct list *);
 static void insert_elem (struct hash *, struct list *, struct hash_elem *);
 static void remove_elem (struct hash *, struct hash_elem *);
+static void migrate (struct hash *, size_t cnt);
 static void rehash (struct hash *);
 
 /* Initializes hash table H to compute hash values using HASH and
@@ -28,6 +31,9 @@ hash_init (struct hash *h,
   h->elem_cnt = 0;
   h->bucket_cnt = 4;
   h->buckets = malloc (sizeof *h->buckets * h->bucket_cnt);
+  h->old_bucket_cnt = 0;
+  h->old_buckets = NULL;
+  h->migrate_idx = 0;
   h->hash = hash;
   h->less = less;
   h->aux = aux;
@@ -53,12 +59,10 @@ hash_init (struct hash *h,
 void
 hash_clear (struct hash *h, hash_action_func *destructor) 
 {
-  size_t i;
+  struct list *bucket;
 
-  for (i = 0; i < h->bucket_cnt; i++) 
+  for (bucket = h->buckets; bucket != NULL; bucket = next_bucket (h, bucket))
     {
-      struct list *bucket = &h->buckets[i];
-
       if (destructor != NULL) 
         while (!list_empty (bucket)) 
           {
@@ -70,6 +74,10 @@ hash_clear (struct hash *h, hash_action_func *destructor)
       list_init (bucket); 
     }    
 
+  free (h->old_buckets);
+  h->old_buckets = NULL;
+  h->old_bucket_cnt = 0;
+  h->migrate_idx = 0;
   h->elem_cnt = 0;
 }
 
@@ -89,6 +97,7 @@ hash_destroy (struct hash *h, hash_action_func *destructor)
   if (destructor != NULL)
     hash_clear (h, destructor);
   free (h->buckets);
+  free (h->old_buckets);
 }
 
 /* Inserts NEW into hash table H and returns a null pointer, if
@@ -98,11 +107,10 @@ hash_destroy (struct hash *h, hash_action_func *destructor)
 struct hash_elem *
 hash_insert (struct hash *h, struct hash_elem *new)
 {
-  struct list *bucket = find_bucket (h, new);
-  struct hash_elem *old = find_elem (h, bucket, new);
+  struct hash_elem *old = find_any (h, new);
 
   if (old == NULL) 
-    insert_elem (h, bucket, new);
+    insert_elem (h, find_bucket (h, new), new);
 
   rehash (h);
 
@@ -114,12 +122,11 @@ hash_insert (struct hash *h, struct hash_elem *new)
 struct hash_elem *
 hash_replace (struct hash *h, struct hash_elem *new) 
 {
-  struct list *bucket = find_bucket (h, new);
-  struct hash_elem *old = find_elem (h, bucket, new);
+  struct hash_elem *old = find_any (h, new);
 
   if (old != NULL)
     remove_elem (h, old);
-  insert_elem (h, bucket, new);
+  insert_elem (h, find_bucket (h, new), new);
 
   rehash (h);
 
@@ -131,7 +138,7 @@ hash_replace (struct hash *h, struct hash_elem *new)
 struct hash_elem *
 hash_find (struct hash *h, struct hash_elem *e) 
 {
-  return find_elem (h, find_bucket (h, e), e);
+  return find_any (h, e);
 }
 
 /* Finds, removes, and returns an element equal to E in hash
@@ -144,7 +151,7 @@ hash_find (struct hash *h, struct hash_elem *e)
 struct hash_elem *
 hash_delete (struct hash *h, struct hash_elem *e)
 {
-  struct hash_elem *found = find_elem (h, find_bucket (h, e), e);
+  struct hash_elem *found = find_any (h, e);
   if (found != NULL) 
     {
       remove_elem (h, found);
@@ -162,13 +169,12 @@ hash_delete (struct hash *h, struct hash_elem *e)
 void
 hash_apply (struct hash *h, hash_action_func *action) 
 {
-  size_t i;
+  struct list *bucket;
   
   ASSERT (action != NULL);
 
-  for (i = 0; i < h->bucket_cnt; i++) 
+  for (bucket = h->buckets; bucket != NULL; bucket = next_bucket (h, bucket))
     {
-      struct list *bucket = &h->buckets[i];
       struct list_elem *elem, *next;
 
       for (elem = list_begin (bucket); elem != list_end (bucket); elem = next) 
@@ -223,7 +229,8 @@ hash_next (struct hash_iterator *i)
   i->elem = list_elem_to_hash_elem (list_next (&i->elem->list_elem));
   while (i->elem == list_elem_to_hash_elem (list_end (i->bucket)))
     {
-      if (++i->bucket >= i->hash->buckets + i->hash->bucket_cnt)
+      i->bucket = next_bucket (i->hash, i->bucket);
+      if (i->bucket == NULL)
         {
           i->elem = NULL;
           break;
@@ -301,7 +308,8 @@ hash_int (int i)
   return hash_bytes (&i, sizeof i);
 }
 
-/* Returns the bucket in H that E belongs in. */
+/* Returns the bucket in H that E belongs in.  New elements
+   always go in the new buckets. */
 static struct list *
 find_bucket (struct hash *h, struct hash_elem *e) 
 {
@@ -325,18 +333,40 @@ find_elem (struct hash *h, struct list *bucket, struct hash_elem *e)
   return NULL;
 }
 
-/* Returns X with its lowest-order bit set to 1 turned off. */
-static inline size_t
-turn_off_least_1bit (size_t x) 
+/* Searches H for a hash element equal to E, in the old buckets
+   as well as the new if the table is being resized.  Returns it
+   if found or a null pointer otherwise. */
+static struct hash_elem *
+find_any (struct hash *h, struct hash_elem *e) 
 {
-  return x & (x - 1);
+  unsigned hash = h->hash (e, h->aux);
+  struct hash_elem *found;
+
+  found = find_elem (h, &h->buckets[hash & (h->bucket_cnt - 1)], e);
+  if (found == NULL && h->old_buckets != NULL) 
+    {
+      size_t old_idx = hash & (h->old_bucket_cnt - 1);
+      if (old_idx >= h->migrate_idx)
+        found = find_elem (h, &h->old_buckets[old_idx], e);
+    }
+  return found;
 }
 
-/* Returns true if X is a power of 2, otherwise false. */
-static inline size_t
-is_power_of_2 (size_t x) 
+/* Returns the bucket that follows BUCKET in H, taking the old
+   buckets still to be emptied after the new ones, or a null
+   pointer if BUCKET is the last. */
+static struct list *
+next_bucket (struct hash *h, struct list *bucket) 
 {
-  return x != 0 && turn_off_least_1bit (x) == 0;
+  if (bucket >= h->buckets && bucket < h->buckets + h->bucket_cnt) 
+    {
+      if (++bucket < h->buckets + h->bucket_cnt)
+        return bucket;
+      return h->old_buckets != NULL ? h->old_buckets + h->migrate_idx : NULL;
+    }
+
+  ASSERT (h->old_buckets != NULL);
+  return ++bucket < h->old_buckets + h->old_bucket_cnt ? bucket : NULL;
 }
 
 /* Element per bucket ratios. */
@@ -344,35 +374,79 @@ is_power_of_2 (size_t x)
 #define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
 #define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
 
+/* Number of old buckets emptied by each insertion or deletion
+   while the table is being resized.  Resizing aims for
+   BEST_ELEMS_PER_BUCKET, so at least half as many operations as
+   there are old buckets pass before the next resize is due, and
+   two per operation is enough to finish first. */
+#define MIGRATE_CNT 2
+
+/* Moves the elements of up to CNT old buckets in hash table H
+   into the new buckets, and frees the old buckets once they are
+   all empty. */
+static void
+migrate (struct hash *h, size_t cnt) 
+{
+  while (cnt-- > 0 && h->migrate_idx < h->old_bucket_cnt) 
+    {
+      struct list *old_bucket = &h->old_buckets[h->migrate_idx++];
+
+      while (!list_empty (old_bucket)) 
+        {
+          struct list_elem *elem = list_pop_front (old_bucket);
+          struct list *new_bucket
+            = find_bucket (h, list_elem_to_hash_elem (elem));
+          list_push_front (new_bucket, elem);
+        }
+    }
+
+  if (h->migrate_idx >= h->old_bucket_cnt) 
+    {
+      free (h->old_buckets);
+      h->old_buckets = NULL;
+      h->old_bucket_cnt = 0;
+      h->migrate_idx = 0;
+    }
+}
+
 /* Changes the number of buckets in hash table H to match the
-   ideal.  This function can fail because of an out-of-memory
-   condition, but that'll just make hash accesses less efficient;
-   we can still continue. */
+   ideal, if it has drifted too far from it, and moves a few
+   buckets' worth of elements toward the new buckets if a resize
+   is in progress.  This function can fail because of an
+   out-of-memory condition, but that'll just make hash accesses
+   less efficient; we can still continue. */
 static void
 rehash (struct hash *h) 
 {
-  size_t old_bucket_cnt, new_bucket_cnt;
-  struct list *new_buckets, *old_buckets;
+  size_t new_bucket_cnt;
+  struct list *new_buckets;
   size_t i;
 
   ASSERT (h != NULL);
 
-  /* Save old bucket info for later use. */
-  old_buckets = h->buckets;
-  old_bucket_cnt = h->bucket_cnt;
+  if (h->old_buckets != NULL)
+    migrate (h, MIGRATE_CNT);
 
-  /* Calculate the number of buckets to use now.
-     We want one bucket for about every BEST_ELEMS_PER_BUCKET.
-     We must have at least four buckets, and the number of
-     buckets must be a power of 2. */
-  new_bucket_cnt = h->elem_cnt / BEST_ELEMS_PER_BUCKET;
-  if (new_bucket_cnt < 4)
-    new_bucket_cnt = 4;
-  while (!is_power_of_2 (new_bucket_cnt))
-    new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
+  /* Calculate the number of buckets to use now, if the load is
+     out of bounds.  We want one bucket for about every
+     BEST_ELEMS_PER_BUCKET, rounding so that the next resize is
+     as far off as the last.  We must have at least four buckets,
+     and the number of buckets must be a power of 2. */
+  new_bucket_cnt = h->bucket_cnt;
+  if (h->elem_cnt > h->bucket_cnt * MAX_ELEMS_PER_BUCKET) 
+    {
+      while (new_bucket_cnt * 2 * BEST_ELEMS_PER_BUCKET <= h->elem_cnt)
+        new_bucket_cnt *= 2;
+    }
+  else if (h->elem_cnt < h->bucket_cnt * MIN_ELEMS_PER_BUCKET) 
+    {
+      while (new_bucket_cnt > 4
+             && new_bucket_cnt / 2 * BEST_ELEMS_PER_BUCKET >= h->elem_cnt)
+        new_bucket_cnt /= 2;
+    }
 
   /* Don't do anything if the bucket count wouldn't change. */
-  if (new_bucket_cnt == old_bucket_cnt)
+  if (new_bucket_cnt == h->bucket_cnt)
     return;
 
   /* Allocate new buckets and initialize them as empty. */
@@ -387,29 +461,19 @@ rehash (struct hash *h)
   for (i = 0; i < new_bucket_cnt; i++) 
     list_init (&new_buckets[i]);
 
-  /* Install new bucket info. */
+  /* A resize should not come due before the last one is done,
+     but if it does, finish the last one first. */
+  if (h->old_buckets != NULL)
+    migrate (h, h->old_bucket_cnt);
+
+  /* Install new bucket info.  The current buckets become the old
+     ones, to be emptied a few at a time. */
+  h->old_buckets = h->buckets;
+  h->old_bucket_cnt = h->bucket_cnt;
+  h->migrate_idx = 0;
   h->buckets = new_buckets;
   h->bucket_cnt = new_bucket_cnt;
-
-  /* Move each old element into the appropriate new bucket. */
-  for (i = 0; i < old_bucket_cnt; i++) 
-    {
-      struct list *old_bucket;
-      struct list_elem *elem, *next;
-
-      old_bucket = &old_buckets[i];
-      for (elem = list_begin (old_bucket);
-           elem != list_end (old_bucket); elem = next) 
-        {
-          struct list *new_bucket
-            = find_bucket (h, list_elem_to_hash_elem (elem));
-          next = list_next (elem);
-          list_remove (elem);
-          list_push_front (new_bucket, elem);
-        }
-    }
-
-  free (old_buckets);
+  migrate (h, MIGRATE_CNT);
 }
 
 /* Inserts E into BUCKET (in hash table H). */
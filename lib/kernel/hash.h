@@ -55,12 +55,22 @@ typedef bool hash_less_func (const struct hash_elem *a,
    data AUX. */
 typedef void hash_action_func (struct hash_elem *e, void *aux);
 
-/* Hash table. */
+/* Hash table.
+
+   When the table grows or shrinks, elements are not all moved to
+   the new buckets at once.  Instead, the old buckets are kept and
+   each insertion or deletion moves the elements of a few of them,
+   so that no single operation takes time proportional to the
+   size of the table.  Until every old bucket has been emptied,
+   searches look in both. */
 struct hash 
   {
     size_t elem_cnt;            /* Number of elements in table. */
     size_t bucket_cnt;          /* Number of buckets, a power of 2. */
     struct list *buckets;       /* Array of `bucket_cnt' lists. */
+    size_t old_bucket_cnt;      /* Number of old buckets, a power of 2. */
+    struct list *old_buckets;   /* Buckets being emptied, or null. */
+    size_t migrate_idx;         /* Old buckets before this are empty. */
     hash_hash_func *hash;       /* Hash function. */
     hash_less_func *less;       /* Comparison function. */
     void *aux;                  /* Auxiliary data for `hash' and `less'. */
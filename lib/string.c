@@ -1,5 +1,18 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The block functions below work a 32-bit word at a time once
+   their operands are aligned.  A word_t may alias any other type,
+   and x86 allows the unaligned loads memcmp() makes through it. */
+typedef uint32_t word_t __attribute__ ((may_alias));
+
+/* Blocks shorter than this are handled a byte at a time, since
+   the setup for the word loops would cost more than it saves. */
+#define WORD_THRESHOLD 16
+
+/* Nonzero if word W contains a zero byte. */
+#define HAS_ZERO_BYTE(W) (((W) - 0x01010101u) & ~(W) & 0x80808080u)
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,6 +25,22 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
+  if (size >= WORD_THRESHOLD) 
+    {
+      size_t words;
+
+      /* Align DST, then move whole words with "rep movsl". */
+      while ((uintptr_t) dst % sizeof (word_t) != 0) 
+        {
+          *dst++ = *src++;
+          size--;
+        }
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+    }
+
   while (size-- > 0)
     *dst++ = *src++;
 
@@ -58,6 +87,16 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* Skip over equal words, leaving the first differing word (if
+     any) for the byte loop to pin down. */
+  for (; size >= sizeof (word_t); size -= sizeof (word_t)) 
+    {
+      if (*(const word_t *) a != *(const word_t *) b)
+        break;
+      a += sizeof (word_t);
+      b += sizeof (word_t);
+    }
+
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -281,6 +320,23 @@ memset (void *dst_, int value, size_t size)
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
+
+  if (size >= WORD_THRESHOLD) 
+    {
+      word_t pattern = (unsigned char) value * 0x01010101u;
+      size_t words;
+
+      /* Align DST, then store whole words with "rep stosl". */
+      while ((uintptr_t) dst % sizeof (word_t) != 0) 
+        {
+          *dst++ = value;
+          size--;
+        }
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words) : "a" (pattern) : "memory");
+    }
   
   while (size-- > 0)
     *dst++ = value;
@@ -296,8 +352,16 @@ strlen (const char *string)
 
   ASSERT (string != NULL);
 
-  for (p = string; *p != '\0'; p++)
-    continue;
+  /* Reach a word boundary, then test a word at a time.  An
+     aligned word never straddles a page, so reading past the
+     terminator this way cannot fault. */
+  for (p = string; (uintptr_t) p % sizeof (word_t) != 0; p++)
+    if (*p == '\0')
+      return p - string;
+  while (!HAS_ZERO_BYTE (*(const word_t *) p))
+    p += sizeof (word_t);
+  while (*p != '\0')
+    p++;
   return p - string;
 }
 
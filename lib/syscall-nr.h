@@ -28,7 +28,68 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_BATCH,                  /* Run several system calls in one trap. */
+    SYS_PIPE,                   /* Create a pipe. */
+    SYS_POLL,                   /* Wait for file descriptors to be ready. */
+    SYS_FCNTL,                  /* Get or set file descriptor flags. */
+    SYS_DUP,                    /* Duplicate a file descriptor. */
+    SYS_DUP2,                   /* Duplicate onto a given descriptor. */
+    SYS_STATS,                  /* Read the kernel's performance counters. */
+    SYS_TRACE                   /* Drain the system call trace. */
+  };
+
+/* One system call in a SYS_BATCH submission.  The caller fills in
+   NR and ARGS; the kernel stores the call's return value in
+   RESULT. */
+struct syscall_record
+  {
+    int nr;                     /* System call number. */
+    unsigned args[3];           /* Arguments, as for a trap. */
+    int result;                 /* Return value. */
+  };
+
+/* Most records one SYS_BATCH call may submit. */
+#define SYSCALL_BATCH_MAX 256
+
+/* File descriptor flags for SYS_FCNTL. */
+#define F_GETFL 1               /* Return the descriptor's flags. */
+#define F_SETFL 2               /* Set the descriptor's flags. */
+#define O_NONBLOCK 0x1          /* Fail with -1 instead of blocking. */
+#define O_CLOEXEC 0x2           /* Not inherited by exec'd children. */
+
+/* One file descriptor to wait for in a SYS_POLL call. */
+struct pollfd
+  {
+    int fd;                     /* File descriptor. */
+    short events;               /* Events of interest. */
+    short revents;              /* Events that occurred. */
+  };
+
+/* Event bits for struct pollfd. */
+#define POLLIN 0x1              /* Data can be read without blocking. */
+#define POLLOUT 0x4             /* Data can be written without blocking. */
+#define POLLERR 0x8             /* Writing end of a pipe has no reader. */
+#define POLLHUP 0x10            /* Reading end of a pipe has no writer. */
+#define POLLNVAL 0x20           /* Not an open file descriptor. */
+
+/* Most file descriptors one SYS_POLL call may wait for. */
+#define POLL_MAX 64
+
+/* One completed system call, as drained by SYS_TRACE.  SEQ
+   counts every call traced since boot, so a gap between two
+   events read in a row means the ring overflowed in between. */
+struct syscall_event
+  {
+    unsigned seq;               /* Sequence number. */
+    int tid;                    /* Calling thread. */
+    int nr;                     /* System call number. */
+    unsigned args[3];           /* Arguments, as for a trap. */
+    int result;                 /* Return value. */
+    unsigned long long start;   /* Time-stamp counter on entry. */
+    unsigned long long cycles;  /* Cycles from entry to return. */
   };
 
 #endif /* lib/syscall-nr.h */
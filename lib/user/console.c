@@ -3,6 +3,18 @@
 #include <syscall.h>
 #include <syscall-nr.h>
 
+/* Size of the standard output buffer. */
+#define STDOUT_BUF_SIZE 1024
+
+/* Standard output is line buffered.  Characters written to it
+   collect here until a new-line is written, the buffer fills up,
+   or fflush() is called, so that printing a line costs one
+   system call instead of one per character. */
+static char stdout_buf[STDOUT_BUF_SIZE];
+static size_t stdout_len;
+
+static void stdout_putc (char);
+
 /* The standard vprintf() function,
    which is like printf() but uses a va_list. */
 int
@@ -30,8 +42,9 @@ hprintf (int handle, const char *format, ...)
 int
 puts (const char *s) 
 {
-  write (STDOUT_FILENO, s, strlen (s));
-  putchar ('\n');
+  while (*s != '\0')
+    stdout_putc (*s++);
+  stdout_putc ('\n');
 
   return 0;
 }
@@ -40,10 +53,37 @@ puts (const char *s)
 int
 putchar (int c) 
 {
-  char c2 = c;
-  write (STDOUT_FILENO, &c2, 1);
+  stdout_putc (c);
   return c;
 }
+
+/* Writes out any output buffered for HANDLE.  Only standard
+   output is buffered, so this does nothing for other handles.
+   Returns 0. */
+int
+fflush (int handle) 
+{
+  if (handle == STDOUT_FILENO && stdout_len > 0) 
+    {
+      /* write() flushes standard output itself before writing to
+         it, so empty the buffer first to keep that from
+         recursing. */
+      size_t len = stdout_len;
+      stdout_len = 0;
+      write (STDOUT_FILENO, stdout_buf, len);
+    }
+  return 0;
+}
+
+/* Adds C to the standard output buffer, flushing it at the end
+   of a line or when it fills up. */
+static void
+stdout_putc (char c) 
+{
+  stdout_buf[stdout_len++] = c;
+  if (c == '\n' || stdout_len >= sizeof stdout_buf)
+    fflush (STDOUT_FILENO);
+}
 
 /* Auxiliary data for vhprintf_helper(). */
 struct vhprintf_aux 
@@ -73,14 +113,20 @@ vhprintf (int handle, const char *format, va_list args)
 }
 
 /* Adds C to the buffer in AUX, flushing it if the buffer fills
-   up. */
+   up.  Standard output goes through its own, longer-lived
+   buffer instead. */
 static void
 add_char (char c, void *aux_) 
 {
   struct vhprintf_aux *aux = aux_;
-  *aux->p++ = c;
-  if (aux->p >= aux->buf + sizeof aux->buf)
-    flush (aux);
+  if (aux->handle == STDOUT_FILENO)
+    stdout_putc (c);
+  else 
+    {
+      *aux->p++ = c;
+      if (aux->p >= aux->buf + sizeof aux->buf)
+        flush (aux);
+    }
   aux->char_cnt++;
 }
 
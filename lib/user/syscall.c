@@ -1,4 +1,5 @@
 #include <syscall.h>
+#include <stdio.h>
 #include "../syscall-nr.h"
 
 /* Invokes syscall NUMBER, passing no arguments, and returns the
@@ -61,9 +62,18 @@
           retval;                                               \
         })
 
+/* Buffered standard output (see console.c) is flushed before any
+   call that ends the process, starts or waits for another one,
+   waits for input, or may write to standard output directly,
+   whether through descriptor 1 or a duplicate of it, so that
+   output still appears in the order it was produced.  It is also
+   flushed before descriptor 1 is closed, so that none of it ends
+   up in whatever is opened as descriptor 1 next. */
+
 void
 halt (void) 
 {
+  fflush (STDOUT_FILENO);
   syscall0 (SYS_HALT);
   NOT_REACHED ();
 }
@@ -71,6 +81,7 @@ halt (void)
 void
 exit (int status)
 {
+  fflush (STDOUT_FILENO);
   syscall1 (SYS_EXIT, status);
   NOT_REACHED ();
 }
@@ -78,12 +89,14 @@ exit (int status)
 pid_t
 exec (const char *file)
 {
+  fflush (STDOUT_FILENO);
   return (pid_t) syscall1 (SYS_EXEC, file);
 }
 
 int
 wait (pid_t pid)
 {
+  fflush (STDOUT_FILENO);
   return syscall1 (SYS_WAIT, pid);
 }
 
@@ -114,12 +127,15 @@ filesize (int fd)
 int
 read (int fd, void *buffer, unsigned size)
 {
+  if (fd == STDIN_FILENO)
+    fflush (STDOUT_FILENO);
   return syscall3 (SYS_READ, fd, buffer, size);
 }
 
 int
 write (int fd, const void *buffer, unsigned size)
 {
+  fflush (STDOUT_FILENO);
   return syscall3 (SYS_WRITE, fd, buffer, size);
 }
 
@@ -138,6 +154,8 @@ tell (int fd)
 void
 close (int fd)
 {
+  if (fd == STDOUT_FILENO)
+    fflush (STDOUT_FILENO);
   syscall1 (SYS_CLOSE, fd);
 }
 
@@ -182,3 +200,107 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+syscall_batch (struct syscall_record *records, unsigned cnt)
+{
+  fflush (STDOUT_FILENO);
+  return syscall2 (SYS_BATCH, records, cnt);
+}
+
+int
+pipe (int fds[2]) 
+{
+  return syscall1 (SYS_PIPE, fds);
+}
+
+int
+poll (struct pollfd *fds, unsigned nfds, int timeout) 
+{
+  fflush (STDOUT_FILENO);
+  return syscall3 (SYS_POLL, fds, nfds, timeout);
+}
+
+int
+fcntl (int fd, int cmd, int arg) 
+{
+  return syscall3 (SYS_FCNTL, fd, cmd, arg);
+}
+
+int
+dup (int fd) 
+{
+  fflush (STDOUT_FILENO);
+  return syscall1 (SYS_DUP, fd);
+}
+
+int
+dup2 (int fd, int newfd) 
+{
+  /* Output buffered for the old NEWFD must go there, not to FD. */
+  if (newfd == STDOUT_FILENO)
+    fflush (STDOUT_FILENO);
+  return syscall2 (SYS_DUP2, fd, newfd);
+}
+
+int
+stats (char *buf, unsigned size) 
+{
+  return syscall2 (SYS_STATS, buf, size);
+}
+
+int
+syscall_trace (struct syscall_event *events, unsigned max) 
+{
+  return syscall2 (SYS_TRACE, events, max);
+}
+
+/* Empties batch B. */
+void
+batch_init (struct batch *b) 
+{
+  b->cnt = 0;
+}
+
+/* Queues system call NR with the given arguments in batch B,
+   submitting the batch first if it is full.  Unused arguments
+   should be passed as 0.  Returns the index of the call's record,
+   whose result batch_result() reports after the next
+   batch_submit(). */
+int
+batch_add (struct batch *b, int nr, unsigned arg0, unsigned arg1,
+           unsigned arg2) 
+{
+  struct syscall_record *r;
+
+  if (b->cnt >= BATCH_SIZE)
+    batch_submit (b);
+
+  r = &b->records[b->cnt];
+  r->nr = nr;
+  r->args[0] = arg0;
+  r->args[1] = arg1;
+  r->args[2] = arg2;
+  r->result = -1;
+  return b->cnt++;
+}
+
+/* Runs every call queued in batch B with a single trap and empties
+   it.  The results stay readable with batch_result() until the
+   next batch_add().  Returns the number of calls run. */
+int
+batch_submit (struct batch *b) 
+{
+  unsigned cnt = b->cnt;
+
+  b->cnt = 0;
+  return cnt > 0 ? syscall_batch (b->records, cnt) : 0;
+}
+
+/* Returns the result of the call at index IDX of batch B's last
+   submission. */
+int
+batch_result (const struct batch *b, int idx) 
+{
+  return b->records[idx].result;
+}
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include "../syscall-nr.h"
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +46,31 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+int syscall_batch (struct syscall_record *, unsigned cnt);
+int pipe (int fds[2]);
+int poll (struct pollfd *, unsigned nfds, int timeout);
+int fcntl (int fd, int cmd, int arg);
+int dup (int fd);
+int dup2 (int fd, int newfd);
+int stats (char *buf, unsigned size);
+int syscall_trace (struct syscall_event *, unsigned max);
+
+/* Number of calls a struct batch holds before batch_add()
+   submits it on its own. */
+#define BATCH_SIZE 64
+
+/* System calls queued to run together in one trap. */
+struct batch
+  {
+    struct syscall_record records[BATCH_SIZE];
+    unsigned cnt;               /* Number of queued calls. */
+  };
+
+void batch_init (struct batch *);
+int batch_add (struct batch *, int nr, unsigned arg0, unsigned arg1,
+               unsigned arg2);
+int batch_submit (struct batch *);
+int batch_result (const struct batch *, int idx);
+
 #endif /* lib/user/syscall.h */
@@ -33,6 +33,20 @@ sub check_expected {
     compare_output ("run", @options, \@output, $expected);
 }
 
+# For tests whose output, such as benchmark timings, varies from
+# run to run: passes if the run was otherwise sound and the test
+# reported "(NAME) PASS".
+sub check_pass_only {
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+
+    my ($name) = $test =~ m%([^/]+)$%;
+    @output = get_core_output ("run", @output);
+    fail "missing PASS in output"
+      unless grep ($_ eq "($name) PASS", @output);
+    pass;
+}
+
 sub common_checks {
     my ($run, @output) = @_;
 
@@ -0,0 +1,101 @@
+/* Measures bitmap scanning over a 1M-bit map, as palloc, the
+   free map and the swap table use it.  Three patterns are timed:
+   finding single free bits in a map that is nearly full, finding
+   runs of free bits among scattered short holes, and allocating
+   every bit of an empty map one bit at a time and then freeing
+   them again.  Also checks the results against a bit-by-bit
+   search. */
+
+#include <bitmap.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "devices/timer.h"
+
+#define BIT_CNT (1024 * 1024)
+#define HOLE_CNT 256
+#define SCAN_CNT 2000
+#define RUN_LEN 8
+
+static size_t slow_scan (const struct bitmap *, size_t start, size_t cnt);
+static void report (const char *what, int ops, int64_t ticks);
+
+void
+test_bench_bitmap (void) 
+{
+  struct bitmap *b;
+  int64_t start;
+  size_t i;
+
+  b = bitmap_create (BIT_CNT);
+  if (b == NULL)
+    fail ("bitmap_create failed");
+  random_init (0);
+
+  /* Nearly full map: a few single free bits, scattered. */
+  bitmap_set_all (b, true);
+  for (i = 0; i < HOLE_CNT; i++)
+    bitmap_reset (b, random_ulong () % BIT_CNT);
+  start = timer_ticks ();
+  for (i = 0; i < SCAN_CNT; i++) 
+    {
+      size_t idx = bitmap_scan_and_flip (b, 0, 1, false);
+      if (idx != BITMAP_ERROR)
+        bitmap_reset (b, idx);
+    }
+  report ("single free bit in full map", SCAN_CNT, timer_elapsed (start));
+
+  /* Short holes that are too small, and a few that are big
+     enough, so the scan must skip many candidate runs. */
+  bitmap_set_all (b, true);
+  for (i = 0; i < HOLE_CNT * 16; i++) 
+    {
+      size_t idx = random_ulong () % (BIT_CNT - RUN_LEN);
+      bitmap_set_multiple (b, idx, random_ulong () % RUN_LEN, false);
+    }
+  if (bitmap_scan (b, 0, RUN_LEN, false) != slow_scan (b, 0, RUN_LEN))
+    fail ("bitmap_scan disagrees with bit-by-bit search");
+  start = timer_ticks ();
+  for (i = 0; i < SCAN_CNT; i++)
+    bitmap_scan (b, random_ulong () % BIT_CNT, RUN_LEN, false);
+  report ("run of free bits among holes", SCAN_CNT, timer_elapsed (start));
+
+  /* Fill an empty map, then empty it again. */
+  bitmap_set_all (b, false);
+  start = timer_ticks ();
+  for (i = 0; i < BIT_CNT; i++)
+    if (bitmap_scan_and_flip (b, 0, 1, false) != i)
+      fail ("allocation %zu returned the wrong bit", i);
+  if (bitmap_scan_and_flip (b, 0, 1, false) != BITMAP_ERROR)
+    fail ("allocation from a full map succeeded");
+  for (i = 0; i < BIT_CNT; i++)
+    bitmap_reset (b, i);
+  report ("fill and empty", BIT_CNT, timer_elapsed (start));
+
+  bitmap_destroy (b);
+  pass ();
+}
+
+/* Finds the first run of CNT false bits in B at or after START
+   the slow way, one bit at a time. */
+static size_t
+slow_scan (const struct bitmap *b, size_t start, size_t cnt) 
+{
+  size_t run = 0;
+  size_t i;
+
+  for (i = start; i < bitmap_size (b); i++) 
+    {
+      run = bitmap_test (b, i) ? 0 : run + 1;
+      if (run == cnt)
+        return i + 1 - cnt;
+    }
+  return BITMAP_ERROR;
+}
+
+static void
+report (const char *what, int ops, int64_t ticks) 
+{
+  msg ("%s: %d operations in %"PRId64" ticks.", what, ops, ticks);
+}
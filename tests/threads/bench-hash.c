@@ -0,0 +1,123 @@
+/* Measures the tail latency of hash table operations while the
+   table grows from empty to many thousands of elements and then
+   shrinks back, through every resize in between.  Reports the
+   mean and worst cycles per insertion and deletion, and checks
+   along the way that every element can be found, whether it
+   still sits in an old bucket or has moved to a new one. */
+
+#include <hash.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <tsc.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+
+#define ELEM_CNT 20000
+
+struct bench_elem 
+  {
+    struct hash_elem elem;
+    int key;
+  };
+
+static unsigned elem_hash (const struct hash_elem *, void *);
+static bool elem_less (const struct hash_elem *, const struct hash_elem *,
+                       void *);
+static bool find (struct hash *, int key);
+static void report (const char *what, uint64_t total, uint64_t worst);
+
+void
+test_bench_hash (void) 
+{
+  struct bench_elem *elems;
+  uint64_t total, worst;
+  struct hash h;
+  int i;
+
+  elems = malloc (sizeof *elems * ELEM_CNT);
+  if (elems == NULL || !hash_init (&h, elem_hash, elem_less, NULL))
+    fail ("out of memory");
+
+  total = worst = 0;
+  for (i = 0; i < ELEM_CNT; i++) 
+    {
+      enum intr_level old_level;
+      uint64_t start, cycles;
+
+      elems[i].key = i;
+      old_level = intr_disable ();
+      start = rdtsc ();
+      if (hash_insert (&h, &elems[i].elem) != NULL)
+        fail ("key %d inserted twice", i);
+      cycles = rdtsc () - start;
+      intr_set_level (old_level);
+
+      total += cycles;
+      if (cycles > worst)
+        worst = cycles;
+      if (!find (&h, i / 2) || !find (&h, i))
+        fail ("key %d lost while growing", i);
+    }
+  report ("insert", total, worst);
+  if (hash_size (&h) != ELEM_CNT)
+    fail ("table holds %zu elements, not %d", hash_size (&h), ELEM_CNT);
+
+  total = worst = 0;
+  for (i = 0; i < ELEM_CNT; i++) 
+    {
+      enum intr_level old_level;
+      uint64_t start, cycles;
+
+      old_level = intr_disable ();
+      start = rdtsc ();
+      if (hash_delete (&h, &elems[i].elem) != &elems[i].elem)
+        fail ("key %d not found for deletion", i);
+      cycles = rdtsc () - start;
+      intr_set_level (old_level);
+
+      total += cycles;
+      if (cycles > worst)
+        worst = cycles;
+      if (find (&h, i) || (i + 1 < ELEM_CNT && !find (&h, ELEM_CNT - 1)))
+        fail ("table wrong after deleting key %d", i);
+    }
+  report ("delete", total, worst);
+  if (!hash_empty (&h))
+    fail ("table not empty after deleting everything");
+
+  hash_destroy (&h, NULL);
+  free (elems);
+  pass ();
+}
+
+static unsigned
+elem_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  return hash_int (hash_entry (e, struct bench_elem, elem)->key);
+}
+
+static bool
+elem_less (const struct hash_elem *a, const struct hash_elem *b,
+           void *aux UNUSED) 
+{
+  return (hash_entry (a, struct bench_elem, elem)->key
+          < hash_entry (b, struct bench_elem, elem)->key);
+}
+
+/* Returns true if H holds an element with KEY. */
+static bool
+find (struct hash *h, int key) 
+{
+  struct bench_elem e;
+
+  e.key = key;
+  return hash_find (h, &e.elem) != NULL;
+}
+
+static void
+report (const char *what, uint64_t total, uint64_t worst) 
+{
+  msg ("%s: %"PRIu64" cycles mean, %"PRIu64" cycles worst.",
+       what, total / ELEM_CNT, worst);
+}
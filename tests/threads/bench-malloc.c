@@ -0,0 +1,88 @@
+/* Measures the cost of small allocations.  Three patterns are
+   timed: a single block allocated and freed over and over (as
+   happens with supplemental page table entries and child_process
+   records), a batch of blocks allocated and then all freed, and
+   the same ping-pong through an object cache with a
+   constructor. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "devices/timer.h"
+
+#define PINGPONG_CNT 200000
+#define BATCH_SIZE 512
+#define BATCH_CNT 200
+
+struct bench_obj 
+  {
+    int magic;
+    char payload[44];
+  };
+
+#define BENCH_OBJ_MAGIC 0x4a7f1d2c
+
+static void bench_obj_ctor (void *);
+static void report (const char *what, int ops, int64_t ticks);
+
+void
+test_bench_malloc (void) 
+{
+  static void *batch[BATCH_SIZE];
+  struct obj_cache *cache;
+  int64_t start;
+  int i, j;
+
+  start = timer_ticks ();
+  for (i = 0; i < PINGPONG_CNT; i++) 
+    {
+      void *p = malloc (48);
+      if (p == NULL)
+        fail ("malloc failed in ping-pong");
+      free (p);
+    }
+  report ("malloc/free ping-pong", PINGPONG_CNT, timer_elapsed (start));
+
+  start = timer_ticks ();
+  for (i = 0; i < BATCH_CNT; i++) 
+    {
+      for (j = 0; j < BATCH_SIZE; j++)
+        if ((batch[j] = malloc (32)) == NULL)
+          fail ("malloc failed in batch");
+      for (j = 0; j < BATCH_SIZE; j++)
+        free (batch[j]);
+    }
+  report ("malloc/free batches", BATCH_CNT * BATCH_SIZE, timer_elapsed (start));
+
+  cache = obj_cache_create ("bench_obj", sizeof (struct bench_obj),
+                            bench_obj_ctor);
+  if (cache == NULL)
+    fail ("obj_cache_create failed");
+  start = timer_ticks ();
+  for (i = 0; i < PINGPONG_CNT; i++) 
+    {
+      struct bench_obj *o = obj_cache_alloc (cache);
+      if (o == NULL)
+        fail ("obj_cache_alloc failed");
+      if (o->magic != BENCH_OBJ_MAGIC)
+        fail ("object handed out without being constructed");
+      obj_cache_free (cache, o);
+    }
+  report ("obj_cache ping-pong", PINGPONG_CNT, timer_elapsed (start));
+
+  pass ();
+}
+
+static void
+bench_obj_ctor (void *o_) 
+{
+  struct bench_obj *o = o_;
+  o->magic = BENCH_OBJ_MAGIC;
+}
+
+static void
+report (const char *what, int ops, int64_t ticks) 
+{
+  msg ("%s: %d operations in %"PRId64" ticks.", what, ops, ticks);
+}
@@ -0,0 +1,73 @@
+/* Measures memcpy() and memset() throughput in bytes per
+   thousand cycles across a range of block sizes, for aligned and
+   misaligned buffers, and checks that the copies come out
+   right. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <tsc.h>
+#include "tests/threads/tests.h"
+
+#define MAX_SIZE 4096
+#define BYTES_PER_SIZE (4 * 1024 * 1024)
+
+static uint8_t src_buf[MAX_SIZE + 8];
+static uint8_t dst_buf[MAX_SIZE + 8];
+
+static void bench (size_t size, size_t misalign);
+static void report (const char *what, size_t size, size_t misalign,
+                    uint64_t cycles);
+
+void
+test_bench_memcpy (void) 
+{
+  static const size_t sizes[] = {16, 64, 256, 1024, 4096};
+  size_t i;
+
+  for (i = 0; i < MAX_SIZE + 8; i++)
+    src_buf[i] = i * 7;
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++) 
+    {
+      bench (sizes[i], 0);
+      bench (sizes[i], 3);
+    }
+  pass ();
+}
+
+/* Copies and fills SIZE-byte blocks MISALIGN bytes past an
+   aligned boundary until BYTES_PER_SIZE bytes have been moved. */
+static void
+bench (size_t size, size_t misalign) 
+{
+  uint8_t *dst = dst_buf + misalign;
+  const uint8_t *src = src_buf + 1;
+  size_t reps = BYTES_PER_SIZE / size;
+  uint64_t start;
+  size_t i;
+
+  start = rdtsc ();
+  for (i = 0; i < reps; i++)
+    memcpy (dst, src, size);
+  report ("memcpy", size, misalign, rdtsc () - start);
+  if (memcmp (dst, src, size))
+    fail ("memcpy of %zu bytes produced wrong data", size);
+
+  start = rdtsc ();
+  for (i = 0; i < reps; i++)
+    memset (dst, i, size);
+  report ("memset", size, misalign, rdtsc () - start);
+  for (i = 0; i < size; i++)
+    if (dst[i] != (uint8_t) (reps - 1))
+      fail ("memset of %zu bytes produced wrong data", size);
+}
+
+static void
+report (const char *what, size_t size, size_t misalign, uint64_t cycles) 
+{
+  if (cycles == 0)
+    cycles = 1;
+  msg ("%s %4zu bytes, offset %zu: %"PRIu64" bytes per 1000 cycles.",
+       what, size, misalign, (uint64_t) BYTES_PER_SIZE * 1000 / cycles);
+}
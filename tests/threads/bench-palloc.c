@@ -0,0 +1,96 @@
+/* Measures the page allocator under churn.  A working set of
+   page runs of random sizes is allocated and freed in random
+   order, and the time per operation is reported along with the
+   largest run that can still be allocated afterward, which shows
+   how badly the churn fragmented the kernel pool. */
+
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "devices/timer.h"
+
+#define SLOT_CNT 64
+#define OP_CNT 100000
+#define MAX_RUN 8
+
+struct run 
+  {
+    void *pages;
+    size_t page_cnt;
+  };
+
+static size_t largest_run (void);
+
+void
+test_bench_palloc (void) 
+{
+  static struct run slots[SLOT_CNT];
+  int64_t start;
+  int ops = 0;
+  int i;
+
+  random_init (0);
+
+  start = timer_ticks ();
+  for (i = 0; i < OP_CNT; i++) 
+    {
+      struct run *r = &slots[random_ulong () % SLOT_CNT];
+
+      if (r->pages != NULL) 
+        {
+          palloc_free_multiple (r->pages, r->page_cnt);
+          r->pages = NULL;
+        }
+      else 
+        {
+          r->page_cnt = random_ulong () % MAX_RUN + 1;
+          r->pages = palloc_get_multiple (0, r->page_cnt);
+          if (r->pages == NULL)
+            fail ("could not allocate %zu pages", r->page_cnt);
+        }
+      ops++;
+    }
+  msg ("%d allocations and frees in %"PRId64" ticks.",
+       ops, timer_elapsed (start));
+
+  msg ("largest run after churn: %zu pages.", largest_run ());
+  palloc_print_stats ();
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (slots[i].pages != NULL)
+      palloc_free_multiple (slots[i].pages, slots[i].page_cnt);
+  msg ("largest run after freeing: %zu pages.", largest_run ());
+
+  pass ();
+}
+
+/* Returns the largest number of contiguous kernel pages that can
+   be allocated right now, found by doubling and then bisecting. */
+static size_t
+largest_run (void) 
+{
+  size_t lo = 0, hi = 1;
+  void *p;
+
+  while ((p = palloc_get_multiple (0, hi)) != NULL) 
+    {
+      palloc_free_multiple (p, hi);
+      lo = hi;
+      hi *= 2;
+    }
+  while (hi - lo > 1) 
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      p = palloc_get_multiple (0, mid);
+      if (p != NULL) 
+        {
+          palloc_free_multiple (p, mid);
+          lo = mid;
+        }
+      else
+        hi = mid;
+    }
+  return lo;
+}
@@ -0,0 +1,88 @@
+/* Measures how quickly short-lived kernel threads can be created
+   and destroyed.  Each round creates a thread that does nothing
+   but signal a semaphore and exit, then waits for it, so that the
+   dead thread's page is released before the next one is created.
+   This is the pattern that fork/exec-heavy workloads put on
+   thread_create() and thread_exit().
+
+   Also checks that dead threads' pages are actually reused, and
+   that a reused page's struct thread starts out clean: each
+   thread scribbles on its own name before it exits, and the next
+   one checks that it got its own name, priority and a fresh tid
+   all the same. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SPAWN_CNT 5000
+
+/* What a spawned thread reports about itself. */
+struct spawn_info
+  {
+    struct semaphore done;      /* Upped when the thread is done. */
+    struct thread *page;        /* Its struct thread. */
+    tid_t tid;                  /* Its tid. */
+    bool clean;                 /* Started with the expected fields? */
+  };
+
+static thread_func spawn_func;
+
+void
+test_bench_spawn (void) 
+{
+  struct spawn_info info;
+  struct thread *last_page = NULL;
+  tid_t last_tid = TID_ERROR;
+  int64_t start, elapsed;
+  int reuse_cnt = 0;
+  int i;
+
+  sema_init (&info.done, 0);
+
+  msg ("Spawning %d threads one at a time.", SPAWN_CNT);
+  start = timer_ticks ();
+  for (i = 0; i < SPAWN_CNT; i++) 
+    {
+      if (thread_create ("spawn", PRI_DEFAULT, spawn_func, &info) == TID_ERROR)
+        fail ("thread_create() failed after %d threads", i);
+      sema_down (&info.done);
+
+      if (!info.clean)
+        fail ("thread %d started with stale fields", i);
+      if (info.tid <= last_tid)
+        fail ("thread %d reused tid %d", i, info.tid);
+      if (info.page == last_page)
+        reuse_cnt++;
+      last_page = info.page;
+      last_tid = info.tid;
+    }
+  elapsed = timer_elapsed (start);
+
+  msg ("%d threads in %"PRId64" ticks (%"PRId64" threads per second).",
+       SPAWN_CNT, elapsed,
+       elapsed > 0 ? SPAWN_CNT * TIMER_FREQ / elapsed : 0);
+  msg ("%d threads reused the previous thread's page.", reuse_cnt);
+  if (reuse_cnt < SPAWN_CNT / 2)
+    fail ("dead threads' pages are not being reused");
+  pass ();
+}
+
+static void
+spawn_func (void *info_) 
+{
+  struct spawn_info *info = info_;
+  struct thread *t = thread_current ();
+
+  info->page = t;
+  info->tid = t->tid;
+  info->clean = (!strcmp (t->name, "spawn")
+                 && t->priority == PRI_DEFAULT
+                 && t->status == THREAD_RUNNING);
+  strlcpy (t->name, "scribbled", sizeof t->name);
+  sema_up (&info->done);
+}
@@ -39,6 +39,12 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"bench-spawn", test_bench_spawn},
+    {"bench-malloc", test_bench_malloc},
+    {"bench-palloc", test_bench_palloc},
+    {"bench-memcpy", test_bench_memcpy},
+    {"bench-bitmap", test_bench_bitmap},
+    {"bench-hash", test_bench_hash},
   };
 
 static const char *test_name;
@@ -33,6 +33,12 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_bench_spawn;
+extern test_func test_bench_malloc;
+extern test_func test_bench_palloc;
+extern test_func test_bench_memcpy;
+extern test_func test_bench_bitmap;
+extern test_func test_bench_hash;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <tsc.h>
 #include "devices/kbd.h"
 #include "devices/input.h"
 #include "devices/serial.h"
@@ -20,6 +21,7 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
 #ifdef USERPROG
@@ -39,6 +41,7 @@
 #endif
 
 #include "vm/frame.h"
+#include "vm/page.h"
 #include "vm/swap.h"
 
 /* Page directory with kernel mappings only. */
@@ -60,6 +63,19 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* Boot phases, timed by the time-stamp counter. */
+#define BOOT_PHASE_MAX 8
+struct boot_phase
+  {
+    const char *name;           /* What was initialized. */
+    uint64_t end;               /* rdtsc() when it was done. */
+  };
+static uint64_t boot_start;
+static struct boot_phase boot_phases[BOOT_PHASE_MAX];
+static int boot_phase_cnt;
+
+static void boot_phase_done (const char *name);
+static void print_boot_phases (void);
 static void bss_init (void);
 static void paging_init (void);
 
@@ -83,6 +99,7 @@ main (void)
 
   /* Clear BSS. */  
   bss_init ();
+  boot_start = rdtsc ();
 
   /* Break command line into arguments and parse options. */
   argv = read_command_line ();
@@ -101,6 +118,7 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+  boot_phase_done ("memory");
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -116,23 +134,31 @@ main (void)
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  process_init ();
 #endif
+  boot_phase_done ("interrupts");
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
   serial_init_queue ();
+  boot_phase_done ("threads");
   timer_calibrate ();
+  boot_phase_done ("calibration");
 
 #ifdef FILESYS
   /* Initialize file system. */
   ide_init ();
   locate_block_devices ();
   filesys_init (format_filesys);
+  boot_phase_done ("filesys");
 #endif
 
+  vm_page_init ();
   frame_table_init ();
   swap_table_init ();
+  boot_phase_done ("vm");
 
+  print_boot_phases ();
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -144,6 +170,35 @@ main (void)
   thread_exit ();
 }
 
+/* Records that boot phase NAME, which began where the previous
+   phase ended, is done. */
+static void
+boot_phase_done (const char *name) 
+{
+  if (boot_phase_cnt < BOOT_PHASE_MAX) 
+    {
+      boot_phases[boot_phase_cnt].name = name;
+      boot_phases[boot_phase_cnt].end = rdtsc ();
+      boot_phase_cnt++;
+    }
+}
+
+/* Prints how many cycles each boot phase took. */
+static void
+print_boot_phases (void) 
+{
+  uint64_t start = boot_start;
+  int i;
+
+  for (i = 0; i < boot_phase_cnt; i++) 
+    {
+      printf ("Boot phase %-12s %'15"PRIu64" cycles\n",
+              boot_phases[i].name, boot_phases[i].end - start);
+      start = boot_phases[i].end;
+    }
+  printf ("Boot took %'"PRIu64" cycles.\n", start - boot_start);
+}
+
 /* Clear the "BSS", a segment that should be initialized to
    zeros.  It isn't actually stored on disk or zeroed by the
    kernel loader, so we have to zero it ourselves.
@@ -157,17 +212,43 @@ bss_init (void)
   memset (&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
-/* Populates the base page directory and page table with the
+/* CR4 bits. */
+#define CR4_PSE 0x00000010      /* Page Size Extensions (4 MB pages). */
+#define CR4_PGE 0x00000080      /* Page Global Enable. */
+
+/* CPUID leaf 1 feature flags, in EDX. */
+#define CPUID_PSE 0x00000008    /* 4 MB pages supported. */
+#define CPUID_PGE 0x00002000    /* Global pages supported. */
+
+/* Populates the base page directory and page tables with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports them, each 4 MB of RAM that holds no
+   kernel text (which must stay read-only) is mapped with a single
+   4 MB page instead of a page table, and every kernel mapping is
+   made global, so that loading CR3 on a process switch leaves
+   the kernel's own TLB entries in place.  Every page directory
+   copies these mappings from init_page_dir, and they never change
+   afterward, so they never need to be flushed. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
+  uint32_t features, cr4, global;
   extern char _start, _end_kernel_text;
 
+  /* See [IA32-v2a] "CPUID--CPU Identification". */
+  asm ("cpuid" : "=d" (features) : "a" (1) : "ebx", "ecx");
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  if (features & CPUID_PSE)
+    cr4 |= CR4_PSE;
+  if (features & CPUID_PGE)
+    cr4 |= CR4_PGE;
+  global = features & CPUID_PGE ? PTE_G : 0;
+
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
   for (page = 0; page < init_ram_pages; page++)
@@ -178,15 +259,28 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (pte_idx == 0 && (cr4 & CR4_PSE)
+          && page + PTSPAN / PGSIZE <= init_ram_pages
+          && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+        {
+          pd[pde_idx] = pde_create_large (vaddr, true) | global;
+          page += PTSPAN / PGSIZE - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
           pd[pde_idx] = pde_create (pt);
         }
 
-      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
+      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text) | global;
     }
 
+  /* Enable 4 MB and global pages before any mapping that uses
+     them takes effect.  See [IA32-v3a] 2.5 "Control Registers". */
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4));
+
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
@@ -263,6 +357,10 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-lpt"))
+        timer_set_calibration (atoi (value));
+      else if (!strcmp (name, "-prof"))
+        profile_enabled = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -386,6 +484,8 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -lpt=LOOPS         Skip timer calibration; use LOOPS per tick.\n"
+          "  -prof              Sample the running code at every timer tick.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
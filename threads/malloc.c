@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -26,7 +27,26 @@
    When we free a block, we add it to its descriptor's free list.
    But if the arena that the block was in now has no in-use
    blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
+   and give the arena back to the page allocator.  Up to
+   EMPTY_ARENA_MAX such empty arenas are kept on the free list
+   instead, so that a pattern of allocating and freeing a single
+   block does not bounce a page to and from the page allocator.
+
+   Each descriptor also has a small "magazine" of recently freed
+   blocks.  free() drops a block into the magazine and malloc()
+   takes one back out with interrupts disabled, without touching
+   the descriptor's lock or free list.  Only when the magazine is
+   empty (or full, for free()) do we fall back to the free list.
+   Because Pintos runs on one CPU, disabling interrupts is enough
+   to make the magazine private to the running thread.
+
+   Object caches, created with obj_cache_create(), are
+   descriptors for objects of one particular type.  Their block
+   size is the object size rather than a power of 2, and they may
+   have a constructor that is run on each object as it comes off
+   the free list.  Objects are expected to be freed in their
+   constructed state, so objects recycled through the magazine
+   are handed out again without running the constructor.
 
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
@@ -34,6 +54,13 @@
    with the page allocator and sticking the allocation size at
    the beginning of the allocated block's arena header. */
 
+/* Number of blocks a descriptor's magazine can hold. */
+#define MAGAZINE_SIZE 16
+
+/* Number of completely free arenas a descriptor keeps instead of
+   returning them to the page allocator. */
+#define EMPTY_ARENA_MAX 1
+
 /* Descriptor. */
 struct desc
   {
@@ -41,6 +68,17 @@ struct desc
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+    size_t empty_cnt;           /* Arenas on free_list with no blocks in use. */
+    void (*ctor) (void *);      /* Object constructor, or null. */
+    void *magazine[MAGAZINE_SIZE]; /* Recently freed blocks. */
+    size_t magazine_cnt;        /* Number of blocks in magazine. */
+  };
+
+/* An object cache: a descriptor for objects of a single type. */
+struct obj_cache
+  {
+    struct desc desc;           /* Descriptor for the objects. */
+    const char *name;           /* Name, for debugging purposes. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -64,6 +102,10 @@ struct block
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+static void desc_init (struct desc *, size_t block_size,
+                       void (*ctor) (void *));
+static void *desc_alloc (struct desc *);
+static void desc_free (struct desc *, struct block *);
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
 
@@ -71,26 +113,44 @@ static struct block *arena_to_block (struct arena *, size_t idx);
 void
 malloc_init (void) 
 {
+  /* Lock names, one per descriptor. */
+  static const char *names[] =
+    {
+      "malloc16", "malloc32", "malloc64", "malloc128",
+      "malloc256", "malloc512", "malloc1024",
+    };
   size_t block_size;
 
   for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
     {
       struct desc *d = &descs[desc_cnt++];
-      ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-      d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
-      lock_init (&d->lock);
+      ASSERT (desc_cnt <= sizeof names / sizeof *names);
+      desc_init (d, block_size, NULL);
+      lock_set_name (&d->lock, names[desc_cnt - 1]);
     }
 }
 
+/* Initializes descriptor D for blocks of BLOCK_SIZE bytes, each
+   initialized by CTOR (if nonnull) when it leaves the free
+   list. */
+static void
+desc_init (struct desc *d, size_t block_size, void (*ctor) (void *))
+{
+  d->block_size = block_size;
+  d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+  list_init (&d->free_list);
+  lock_init (&d->lock);
+  d->empty_cnt = 0;
+  d->ctor = ctor;
+  d->magazine_cnt = 0;
+}
+
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) 
 {
   struct desc *d;
-  struct block *b;
   struct arena *a;
 
   /* A null pointer satisfies a request for 0 bytes. */
@@ -119,37 +179,72 @@ malloc (size_t size)
       return a + 1;
     }
 
+  return desc_alloc (d);
+}
+
+/* Obtains a block from descriptor D, first trying its magazine
+   and then its free list.  Returns a null pointer if memory is
+   not available. */
+static void *
+desc_alloc (struct desc *d) 
+{
+  enum intr_level old_level;
+  struct block *b;
+  struct arena *a;
+
+  /* Fast path: reuse a recently freed block. */
+  old_level = intr_disable ();
+  if (d->magazine_cnt > 0)
+    {
+      b = d->magazine[--d->magazine_cnt];
+      intr_set_level (old_level);
+      return b;
+    }
+  intr_set_level (old_level);
+
   lock_acquire (&d->lock);
 
-  /* If the free list is empty, create a new arena. */
+  /* If the free list is empty, create a new arena.  The page is
+     allocated without D's lock held, because palloc may call the
+     shrinker, which frees memory (perhaps to D) and takes the
+     frame table's lock, which is held around other allocations.
+     Meanwhile another thread may have refilled the free list, in
+     which case the new page goes back. */
   if (list_empty (&d->free_list))
     {
       size_t i;
 
-      /* Allocate a page. */
+      lock_release (&d->lock);
       a = palloc_get_page (0);
       if (a == NULL) 
+        return NULL; 
+      lock_acquire (&d->lock);
+      if (!list_empty (&d->free_list))
+        palloc_free_page (a);
+      else
         {
-          lock_release (&d->lock);
-          return NULL; 
-        }
-
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
+          /* Initialize arena and add its blocks to the free list. */
+          a->magic = ARENA_MAGIC;
+          a->desc = d;
+          a->free_cnt = d->blocks_per_arena;
+          for (i = 0; i < d->blocks_per_arena; i++) 
+            {
+              struct block *b = arena_to_block (a, i);
+              list_push_back (&d->free_list, &b->free_elem);
+            }
+          d->empty_cnt++;
         }
     }
 
   /* Get a block from free list and return it. */
   b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
   a = block_to_arena (b);
-  a->free_cnt--;
+  if (a->free_cnt-- == d->blocks_per_arena)
+    d->empty_cnt--;
   lock_release (&d->lock);
+
+  if (d->ctor != NULL)
+    d->ctor (b);
   return b;
 }
 
@@ -227,42 +322,119 @@ free (void *p)
       if (d != NULL) 
         {
           /* It's a normal block.  We handle it here. */
+          desc_free (d, b);
+        }
+      else
+        {
+          /* It's a big block.  Free its pages. */
+          palloc_free_multiple (a, a->free_cnt);
+          return;
+        }
+    }
+}
+
+/* Returns block B to descriptor D, putting it in D's magazine if
+   there is room and on D's free list otherwise. */
+static void
+desc_free (struct desc *d, struct block *b) 
+{
+  enum intr_level old_level;
+  struct arena *a;
 
 #ifndef NDEBUG
-          /* Clear the block to help detect use-after-free bugs. */
-          memset (b, 0xcc, d->block_size);
+  /* Clear the block to help detect use-after-free bugs.  Objects
+     with a constructor must keep their constructed state. */
+  if (d->ctor == NULL)
+    memset (b, 0xcc, d->block_size);
 #endif
-  
-          lock_acquire (&d->lock);
 
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
+  /* Fast path: keep the block for the next allocation. */
+  old_level = intr_disable ();
+  if (d->magazine_cnt < MAGAZINE_SIZE)
+    {
+      d->magazine[d->magazine_cnt++] = b;
+      intr_set_level (old_level);
+      return;
+    }
+  intr_set_level (old_level);
 
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
-            {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
-            }
+  lock_acquire (&d->lock);
 
-          lock_release (&d->lock);
-        }
+  /* Add block to free list. */
+  list_push_front (&d->free_list, &b->free_elem);
+
+  /* If the arena is now entirely unused, keep it for later or
+     free it. */
+  a = block_to_arena (b);
+  if (++a->free_cnt >= d->blocks_per_arena) 
+    {
+      ASSERT (a->free_cnt == d->blocks_per_arena);
+      if (d->empty_cnt < EMPTY_ARENA_MAX)
+        d->empty_cnt++;
       else
         {
-          /* It's a big block.  Free its pages. */
-          palloc_free_multiple (a, a->free_cnt);
-          return;
+          size_t i;
+
+          for (i = 0; i < d->blocks_per_arena; i++) 
+            {
+              struct block *b = arena_to_block (a, i);
+              list_remove (&b->free_elem);
+            }
+          palloc_free_page (a);
         }
     }
+
+  lock_release (&d->lock);
 }
-
+
+/* Creates and returns a cache for objects of SIZE bytes, named
+   NAME for debugging purposes.  If CTOR is nonnull, it is called
+   on each object as it comes off the free list, whose link
+   overwrites the object's first bytes, but not on objects
+   recycled through the magazine, so objects should be returned
+   to the cache in their constructed state.  Returns a null
+   pointer if memory is not available. */
+struct obj_cache *
+obj_cache_create (const char *name, size_t size, void (*ctor) (void *))
+{
+  struct obj_cache *c;
+
+  ASSERT (size > 0 && size < PGSIZE / 2);
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    return NULL;
+
+  /* Blocks must be able to hold a free list element and must
+     keep the objects in them aligned. */
+  if (size < sizeof (struct block))
+    size = sizeof (struct block);
+  desc_init (&c->desc, ROUND_UP (size, sizeof (void *)), ctor);
+  lock_set_name (&c->desc.lock, name);
+  c->name = name;
+  return c;
+}
+
+/* Obtains an object from cache C.  Returns a null pointer if
+   memory is not available. */
+void *
+obj_cache_alloc (struct obj_cache *c) 
+{
+  return desc_alloc (&c->desc);
+}
+
+/* Returns object P, which must have been obtained from
+   obj_cache_alloc() on cache C, to C.  A null P is ignored. */
+void
+obj_cache_free (struct obj_cache *c, void *p) 
+{
+  if (p != NULL)
+    {
+      ASSERT (block_to_arena (p)->desc == &c->desc);
+      desc_free (&c->desc, p);
+    }
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
@@ -10,4 +10,11 @@ void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
 
+/* Cache of objects of a single type. */
+struct obj_cache;
+struct obj_cache *obj_cache_create (const char *name, size_t size,
+                                    void (*ctor) (void *));
+void *obj_cache_alloc (struct obj_cache *) __attribute__ ((malloc));
+void obj_cache_free (struct obj_cache *, void *);
+
 #endif /* threads/malloc.h */
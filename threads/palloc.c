@@ -2,13 +2,14 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,22 +24,76 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is managed as a binary buddy allocator.  Free memory
+   is kept as blocks of 2**ORDER pages, aligned to their size
+   relative to the start of the pool, on one free list per order.
+   A request for N pages takes a block of the smallest order that
+   fits, splitting larger blocks as needed, and gives the pages
+   beyond N back.  Freeing a block merges it with its "buddy", the
+   other half of the next larger block, for as long as the buddy
+   is also free.  Both operations take time proportional to the
+   number of orders, not to the size of the pool, so the pools are
+   protected by disabling interrupts rather than by a lock.  This
+   also allows pages to be freed with interrupts already off, as
+   thread_schedule_tail() does.
+
+   The split between the pools is only a preference.  When the
+   kernel pool runs dry, kernel allocations are served from the
+   user pool, and if that is exhausted as well, the registered
+   shrinker (the VM frame table) is asked to give user pages
+   back until the request can be met, up to SHRINK_MAX pages per
+   request. */
+
+/* Largest block order.  A pool never has free blocks of more than
+   2**PALLOC_MAX_ORDER pages. */
+#define PALLOC_MAX_ORDER 15
+
+/* Most user pages one allocation may reclaim through the
+   shrinker, so that a large kernel request that still cannot be
+   met does not empty the whole frame table trying. */
+#define SHRINK_MAX 64
+
+/* Values of a pool's page_state[] entries.  The first page of
+   each free block holds FREE_HEAD ORed with the block's order;
+   all other free pages hold PAGE_FREE. */
+#define PAGE_USED 0xff                  /* Allocated page. */
+#define PAGE_FREE 0xfe                  /* Free page, not a block head. */
+#define FREE_HEAD 0x80                  /* Flag for first page of free block. */
+
+/* A free block, stored in its own first page. */
+struct free_block
+  {
+    struct list_elem elem;              /* Element in a free list. */
+  };
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
-    struct bitmap *used_map;            /* Bitmap of free pages. */
+    uint8_t *page_state;                /* State of each page. */
+    struct list free_lists[PALLOC_MAX_ORDER + 1]; /* Free blocks by order. */
+    size_t page_cnt;                    /* Number of pages in pool. */
+    size_t free_cnt;                    /* Number of free pages. */
     uint8_t *base;                      /* Base of pool. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Called to reclaim user pages when a kernel allocation fails. */
+static palloc_shrink_func *shrinker;
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static void *get_pages (struct pool *, size_t page_cnt);
+static size_t pool_alloc (struct pool *, size_t page_cnt);
+static void pool_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static void insert_block (struct pool *, size_t page_idx, unsigned order);
+static struct free_block *idx_to_block (struct pool *, size_t page_idx);
+static size_t block_to_idx (struct pool *, struct free_block *);
 size_t num_user_pages;
 
 int 
@@ -77,21 +132,28 @@ palloc_init (size_t user_page_limit)
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
-  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
   void *pages;
-  size_t page_idx;
+  int shrink_cnt = 0;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  if (flags & PAL_USER)
+    pages = get_pages (&user_pool, page_cnt);
+  else 
+    {
+      pages = get_pages (&kernel_pool, page_cnt);
+      if (pages == NULL)
+        pages = get_pages (&user_pool, page_cnt);
 
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
+      /* The shrinker may sleep, so it can only run in a thread
+         that could have blocked anyway. */
+      while (pages == NULL && shrinker != NULL
+             && shrink_cnt++ < SHRINK_MAX
+             && !intr_context () && intr_get_level () == INTR_ON
+             && shrinker ())
+        pages = get_pages (&user_pool, page_cnt);
+    }
 
   if (pages != NULL) 
     {
@@ -125,6 +187,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT (pg_ofs (pages) == 0);
@@ -144,8 +207,9 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  old_level = intr_disable ();
+  pool_free (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -155,18 +219,61 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Registers SHRINK as the function to call to free user pages
+   when a kernel allocation cannot otherwise be satisfied.  SHRINK
+   should free at least one user pool page and return true, or
+   return false if it cannot. */
+void
+palloc_set_shrinker (palloc_shrink_func *shrink) 
+{
+  shrinker = shrink;
+}
+
+/* Prints the number of free pages in each pool and the size of
+   the largest block that could currently be allocated from it. */
+void
+palloc_print_stats (void) 
+{
+  struct pool *pools[2] = {&kernel_pool, &user_pool};
+  const char *names[2] = {"kernel", "user"};
+  int i;
+
+  for (i = 0; i < 2; i++)
+    {
+      struct pool *p = pools[i];
+      enum intr_level old_level;
+      size_t free_cnt;
+      int order;
+
+      old_level = intr_disable ();
+      free_cnt = p->free_cnt;
+      for (order = PALLOC_MAX_ORDER; order >= 0; order--)
+        if (!list_empty (&p->free_lists[order]))
+          break;
+      intr_set_level (old_level);
+
+      printf ("Palloc: %s pool %zu of %zu pages free, "
+              "largest free block %zu pages\n",
+              names[i], free_cnt, p->page_cnt,
+              order >= 0 ? (size_t) 1 << order : 0);
+    }
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  size_t st_pages;
+  size_t i;
+
+  /* We'll put the pool's page_state at its base.
+     Calculate the space needed for it and subtract it from the
+     pool's size. */
+  st_pages = DIV_ROUND_UP (page_cnt, PGSIZE + 1);
+  if (st_pages > page_cnt)
+    PANIC ("Not enough memory in %s for page state.", name);
+  page_cnt -= st_pages;
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
   if (!strcmp(name, "user pool"))
@@ -174,10 +281,17 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
     num_user_pages = page_cnt;
   }
 
-  /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  /* Initialize the pool.  Every page starts out allocated, and
+     then the whole pool is freed, which carves it into the
+     largest aligned blocks that fit. */
+  p->page_state = base;
+  memset (p->page_state, PAGE_USED, page_cnt);
+  for (i = 0; i <= PALLOC_MAX_ORDER; i++)
+    list_init (&p->free_lists[i]);
+  p->page_cnt = page_cnt;
+  p->free_cnt = 0;
+  p->base = (uint8_t *) base + st_pages * PGSIZE;
+  pool_free (p, 0, page_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -187,7 +301,147 @@ page_from_pool (const struct pool *pool, void *page)
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   first one, or a null pointer if POOL has no run that long. */
+static void *
+get_pages (struct pool *pool, size_t page_cnt) 
+{
+  enum intr_level old_level;
+  size_t page_idx;
+
+  old_level = intr_disable ();
+  page_idx = pool_alloc (pool, page_cnt);
+  intr_set_level (old_level);
+
+  return page_idx != BITMAP_ERROR ? pool->base + PGSIZE * page_idx : NULL;
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first one, or BITMAP_ERROR if no block is large
+   enough.  Interrupts must be off. */
+static size_t
+pool_alloc (struct pool *p, size_t page_cnt) 
+{
+  unsigned order, want;
+  size_t page_idx, i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Smallest order that holds PAGE_CNT pages. */
+  for (want = 0; ((size_t) 1 << want) < page_cnt; want++)
+    if (want == PALLOC_MAX_ORDER)
+      return BITMAP_ERROR;
+
+  /* Smallest order at or above WANT with a free block. */
+  for (order = want; order <= PALLOC_MAX_ORDER; order++)
+    if (!list_empty (&p->free_lists[order]))
+      break;
+  if (order > PALLOC_MAX_ORDER)
+    return BITMAP_ERROR;
+
+  page_idx = block_to_idx (p, list_entry (list_pop_front (&p->free_lists[order]),
+                                          struct free_block, elem));
+  ASSERT (p->page_state[page_idx] == (FREE_HEAD | order));
+  p->page_state[page_idx] = PAGE_FREE;
+
+  /* Split the block until it is of order WANT, putting the upper
+     halves back on the free lists. */
+  while (order > want)
+    {
+      size_t buddy;
+
+      order--;
+      buddy = page_idx + ((size_t) 1 << order);
+      p->page_state[buddy] = FREE_HEAD | order;
+      list_push_front (&p->free_lists[order], &idx_to_block (p, buddy)->elem);
+    }
+
+  /* Claim the pages we need and give back the rest. */
+  for (i = 0; i < page_cnt; i++)
+    p->page_state[page_idx + i] = PAGE_USED;
+  p->free_cnt -= (size_t) 1 << want;
+  free_range (p, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+
+  return page_idx;
+}
+
+/* Returns the PAGE_CNT pages starting at PAGE_IDX, all of which
+   must be allocated, to pool P.  Interrupts must be off. */
+static void
+pool_free (struct pool *p, size_t page_idx, size_t page_cnt) 
+{
+  size_t i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (page_idx + page_cnt <= p->page_cnt);
+
+  for (i = 0; i < page_cnt; i++)
+    {
+      ASSERT (p->page_state[page_idx + i] == PAGE_USED);
+      p->page_state[page_idx + i] = PAGE_FREE;
+    }
+  free_range (p, page_idx, page_cnt);
+}
+
+/* Puts the PAGE_CNT pages starting at PAGE_IDX, which must
+   already be marked PAGE_FREE, onto P's free lists as the
+   largest aligned blocks that cover them. */
+static void
+free_range (struct pool *p, size_t page_idx, size_t page_cnt) 
+{
+  p->free_cnt += page_cnt;
+  while (page_cnt > 0)
+    {
+      unsigned order = 0;
+
+      while (order < PALLOC_MAX_ORDER
+             && (page_idx & ((size_t) 1 << order)) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+
+      insert_block (p, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Adds the free block of 2**ORDER pages at PAGE_IDX to P,
+   merging it with its buddy for as long as the buddy is free. */
+static void
+insert_block (struct pool *p, size_t page_idx, unsigned order) 
+{
+  while (order < PALLOC_MAX_ORDER)
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+      if (buddy >= p->page_cnt || p->page_state[buddy] != (FREE_HEAD | order))
+        break;
+
+      list_remove (&idx_to_block (p, buddy)->elem);
+      p->page_state[buddy] = PAGE_FREE;
+      page_idx &= ~((size_t) 1 << order);
+      order++;
+    }
+
+  p->page_state[page_idx] = FREE_HEAD | order;
+  list_push_front (&p->free_lists[order], &idx_to_block (p, page_idx)->elem);
+}
+
+/* Returns the free block that starts at page PAGE_IDX of P. */
+static struct free_block *
+idx_to_block (struct pool *p, size_t page_idx) 
+{
+  return (struct free_block *) (p->base + PGSIZE * page_idx);
+}
+
+/* Returns the index of the page that free block B starts at. */
+static size_t
+block_to_idx (struct pool *p, struct free_block *b) 
+{
+  return pg_no (b) - pg_no (p->base);
+}
@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -11,11 +12,17 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
+/* Frees at least one user page, returning false if none could be
+   freed.  See palloc_set_shrinker(). */
+typedef bool palloc_shrink_func (void);
+
 void palloc_init (size_t user_page_limit);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
 int palloc_get_num_user_pages (void);
+void palloc_set_shrinker (palloc_shrink_func *);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
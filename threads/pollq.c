@@ -0,0 +1,103 @@
+#include "threads/pollq.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Initializes P for the current thread to wait with. */
+void
+poller_init (struct poller *p) 
+{
+  p->thread = thread_current ();
+  p->woken = false;
+  p->sleeping = false;
+}
+
+/* Blocks until one of the pollqs that P has entries on is woken,
+   or returns at once if that already happened since
+   poller_init(). */
+void
+poller_sleep (struct poller *p) 
+{
+  enum intr_level old_level;
+
+  ASSERT (!intr_context ());
+  ASSERT (p->thread == thread_current ());
+
+  old_level = intr_disable ();
+  if (!p->woken) 
+    {
+      p->sleeping = true;
+      thread_block ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Initializes Q as an empty poll queue. */
+void
+pollq_init (struct pollq *q) 
+{
+  list_init (&q->entries);
+}
+
+/* Initializes E as not being in any poll queue. */
+void
+pollq_entry_init (struct pollq_entry *e) 
+{
+  e->poller = NULL;
+  e->queued = false;
+}
+
+/* Adds E, which must not already be in a poll queue, to Q, so
+   that waking Q wakes poller P. */
+void
+pollq_add (struct pollq *q, struct pollq_entry *e, struct poller *p) 
+{
+  enum intr_level old_level;
+
+  ASSERT (!e->queued);
+
+  e->poller = p;
+  old_level = intr_disable ();
+  list_push_back (&q->entries, &e->elem);
+  e->queued = true;
+  intr_set_level (old_level);
+}
+
+/* Removes E from the poll queue it is in, if any.  A poller must
+   remove all of its entries before it goes out of scope. */
+void
+pollq_remove (struct pollq_entry *e) 
+{
+  enum intr_level old_level = intr_disable ();
+  if (e->queued) 
+    {
+      list_remove (&e->elem);
+      e->queued = false;
+    }
+  intr_set_level (old_level);
+}
+
+/* Wakes every poller with an entry in Q.  Each poller is woken at
+   most once, however many of its queues fire. */
+void
+pollq_wake (struct pollq *q) 
+{
+  enum intr_level old_level = intr_disable ();
+  struct list_elem *e;
+
+  for (e = list_begin (&q->entries); e != list_end (&q->entries);
+       e = list_next (e)) 
+    {
+      struct poller *p = list_entry (e, struct pollq_entry, elem)->poller;
+      if (!p->woken) 
+        {
+          p->woken = true;
+          if (p->sleeping) 
+            {
+              p->sleeping = false;
+              thread_unblock (p->thread);
+            }
+        }
+    }
+  intr_set_level (old_level);
+}
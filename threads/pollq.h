@@ -0,0 +1,53 @@
+#ifndef THREADS_POLLQ_H
+#define THREADS_POLLQ_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/* Poll queues let one thread sleep until any of several event
+   sources becomes ready.
+
+   Each event source (an input buffer, a pipe, ...) owns a struct
+   pollq.  A thread that wants to wait initializes a struct
+   poller, adds one struct pollq_entry to the pollq of every
+   source it is interested in, checks each source, and calls
+   poller_sleep() only if none was ready.  A source calls
+   pollq_wake() whenever its state changes, which wakes every
+   poller with an entry on it.  Because entries are added before
+   the sources are checked, a wakeup that races with the checks
+   is never lost: it just makes poller_sleep() return at once.
+
+   pollq_wake() may be called from an interrupt handler. */
+
+/* A thread waiting on one or more poll queues. */
+struct poller
+  {
+    struct thread *thread;      /* Waiting thread. */
+    bool woken;                 /* Woken since poller_init()? */
+    bool sleeping;              /* Blocked in poller_sleep()? */
+  };
+
+/* An event source's list of waiting pollers. */
+struct pollq
+  {
+    struct list entries;        /* List of struct pollq_entry. */
+  };
+
+/* Links a poller to one pollq. */
+struct pollq_entry
+  {
+    struct list_elem elem;      /* Element in pollq's entries. */
+    struct poller *poller;      /* Poller to wake. */
+    bool queued;                /* Currently in a pollq? */
+  };
+
+void poller_init (struct poller *);
+void poller_sleep (struct poller *);
+
+void pollq_init (struct pollq *);
+void pollq_entry_init (struct pollq_entry *);
+void pollq_add (struct pollq *, struct pollq_entry *, struct poller *);
+void pollq_remove (struct pollq_entry *);
+void pollq_wake (struct pollq *);
+
+#endif /* threads/pollq.h */
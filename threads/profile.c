@@ -0,0 +1,117 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/synch.h"
+
+/* Number of distinct addresses that can be counted.  A power of
+   2.  Samples at further addresses count only toward the
+   totals. */
+#define PROFILE_SLOTS 1024
+
+/* Number of addresses printed by profile_print(). */
+#define PROFILE_TOP 20
+
+/* Samples at one address. */
+struct profile_slot
+  {
+    uintptr_t eip;              /* Address, or 0 if the slot is free. */
+    unsigned cnt;               /* Number of samples there. */
+  };
+
+/* If true, timer interrupts take samples.  Set by the "-prof"
+   kernel option. */
+bool profile_enabled;
+
+/* Samples, found by open addressing on the address.  Updated only
+   by the timer interrupt handler. */
+static struct profile_slot slots[PROFILE_SLOTS];
+static int64_t kernel_samples;          /* Samples in kernel code. */
+static int64_t user_samples;            /* Samples in user code. */
+static int64_t dropped_samples;         /* Samples with no free slot. */
+
+/* Records the instruction interrupted by the timer interrupt
+   whose frame is F.  Called from the timer interrupt handler. */
+void
+profile_sample (const struct intr_frame *f) 
+{
+  uintptr_t eip = (uintptr_t) f->eip;
+  size_t i, probes;
+
+  ASSERT (intr_context ());
+
+  if (f->cs == SEL_KCSEG)
+    kernel_samples++;
+  else
+    user_samples++;
+
+  i = hash_int (eip) & (PROFILE_SLOTS - 1);
+  for (probes = 0; probes < PROFILE_SLOTS; probes++) 
+    {
+      struct profile_slot *s = &slots[i];
+      if (s->eip == eip || s->eip == 0) 
+        {
+          s->eip = eip;
+          s->cnt++;
+          return;
+        }
+      i = (i + 1) & (PROFILE_SLOTS - 1);
+    }
+  dropped_samples++;
+}
+
+/* Prints the PROFILE_TOP addresses with the most samples, most
+   first, then all of them on a line that, pasted after the
+   kernel and user binaries' names on the command line of the
+   "backtrace" utility, prints the function and line of each in
+   the same order, e.g.
+   "backtrace kernel.o page-merge-par Profile: 0xc0101234 ...". */
+void
+profile_print (void) 
+{
+  struct profile_slot top[PROFILE_TOP];
+  int64_t total;
+  int n = 0;
+  size_t i;
+  int j;
+
+  if (!profile_enabled)
+    return;
+
+  /* Stop sampling so the table holds still. */
+  profile_enabled = false;
+  barrier ();
+
+  for (i = 0; i < PROFILE_SLOTS; i++) 
+    {
+      if (slots[i].cnt == 0)
+        continue;
+
+      /* Insertion sort into TOP. */
+      for (j = n; j > 0 && top[j - 1].cnt < slots[i].cnt; j--)
+        if (j < PROFILE_TOP)
+          top[j] = top[j - 1];
+      if (j < PROFILE_TOP) 
+        {
+          top[j] = slots[i];
+          if (n < PROFILE_TOP)
+            n++;
+        }
+    }
+
+  total = kernel_samples + user_samples;
+  printf ("Profile: %"PRId64" samples, %"PRId64" kernel, %"PRId64" user, "
+          "%"PRId64" not counted by address\n",
+          total, kernel_samples, user_samples, dropped_samples);
+  for (j = 0; j < n; j++)
+    printf ("  %8u %3"PRId64"%%  %#010"PRIxPTR"\n", top[j].cnt,
+            top[j].cnt * (int64_t) 100 / total, top[j].eip);
+  printf ("Profile:");
+  for (j = 0; j < n; j++)
+    printf (" %#"PRIxPTR, top[j].eip);
+  printf ("\n");
+}
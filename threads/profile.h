@@ -0,0 +1,17 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+
+struct intr_frame;
+
+/* Sampling profiler.  When enabled (with the "-prof" kernel
+   option), every timer interrupt records the address of the
+   instruction it interrupted, kernel or user, and the hottest
+   addresses are printed at shutdown. */
+extern bool profile_enabled;
+
+void profile_sample (const struct intr_frame *);
+void profile_print (void);
+
+#endif /* threads/profile.h */
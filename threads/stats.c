@@ -0,0 +1,253 @@
+#include "threads/stats.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <syscall-nr.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A histogram. */
+struct histogram
+  {
+    int64_t cnt;                        /* Number of values. */
+    uint64_t sum;                       /* Sum of values. */
+    int64_t buckets[STAT_HIST_BUCKETS]; /* Values by power of 2. */
+  };
+
+int64_t stat_counters[STAT_CNT];
+static struct histogram histograms[STAT_HIST_CNT];
+static int64_t syscall_cnts[STAT_SYSCALL_MAX];
+static struct histogram syscall_hists[STAT_SYSCALL_MAX];
+
+/* Names of counters, histograms and system calls, as dumped. */
+static const char *counter_names[STAT_CNT] =
+  {
+    [STAT_PAGE_FAULTS] = "vm.page_faults",
+    [STAT_EVICTIONS] = "vm.evictions",
+    [STAT_SWAP_INS] = "vm.swap_ins",
+    [STAT_SWAP_OUTS] = "vm.swap_outs",
+    [STAT_LOCK_WAITS] = "sync.lock_waits",
+  };
+
+static const char *histogram_names[STAT_HIST_CNT] =
+  {
+    [STAT_HIST_BLOCK_READ] = "block.read_cycles",
+    [STAT_HIST_BLOCK_WRITE] = "block.write_cycles",
+  };
+
+static const char *syscall_names[STAT_SYSCALL_MAX] =
+  {
+    [SYS_HALT] = "halt",
+    [SYS_EXIT] = "exit",
+    [SYS_EXEC] = "exec",
+    [SYS_WAIT] = "wait",
+    [SYS_CREATE] = "create",
+    [SYS_REMOVE] = "remove",
+    [SYS_OPEN] = "open",
+    [SYS_FILESIZE] = "filesize",
+    [SYS_READ] = "read",
+    [SYS_WRITE] = "write",
+    [SYS_SEEK] = "seek",
+    [SYS_TELL] = "tell",
+    [SYS_CLOSE] = "close",
+    [SYS_MMAP] = "mmap",
+    [SYS_MUNMAP] = "munmap",
+    [SYS_CHDIR] = "chdir",
+    [SYS_MKDIR] = "mkdir",
+    [SYS_READDIR] = "readdir",
+    [SYS_ISDIR] = "isdir",
+    [SYS_INUMBER] = "inumber",
+    [SYS_BATCH] = "batch",
+    [SYS_PIPE] = "pipe",
+    [SYS_POLL] = "poll",
+    [SYS_FCNTL] = "fcntl",
+    [SYS_DUP] = "dup",
+    [SYS_DUP2] = "dup2",
+    [SYS_STATS] = "stats",
+    [SYS_TRACE] = "trace",
+  };
+
+/* Most locks listed by stats_format(). */
+#define STAT_LOCK_TOP 10
+
+/* Text being formatted into a buffer. */
+struct stats_buf
+  {
+    char *buf;                  /* Buffer. */
+    size_t size;                /* Size of buffer. */
+    size_t len;                 /* Bytes formatted, perhaps not all stored. */
+  };
+
+static void hist_add (struct histogram *, uint64_t value);
+static void append (struct stats_buf *, const char *format, ...)
+  PRINTF_FORMAT (2, 3);
+static void append_histogram (struct stats_buf *, const struct histogram *);
+
+/* Returns the value of counter C. */
+int64_t
+stat_get (enum stat_counter c) 
+{
+  enum intr_level old_level;
+  int64_t value;
+
+  ASSERT (c < STAT_CNT);
+  old_level = intr_disable ();
+  value = stat_counters[c];
+  intr_set_level (old_level);
+  return value;
+}
+
+/* Adds VALUE to histogram H. */
+void
+stat_record (enum stat_histogram h, uint64_t value) 
+{
+  ASSERT (h < STAT_HIST_CNT);
+  hist_add (&histograms[h], value);
+}
+
+/* Counts a call of system call NR. */
+void
+stat_syscall (int nr) 
+{
+  if (nr >= 0 && nr < STAT_SYSCALL_MAX) 
+    {
+      enum intr_level old_level = intr_disable ();
+      syscall_cnts[nr]++;
+      intr_set_level (old_level);
+    }
+}
+
+/* Records that a call of system call NR returned CYCLES after it
+   was made.  Calls that never return, such as exit, are counted
+   by stat_syscall() but never timed. */
+void
+stat_syscall_time (int nr, uint64_t cycles) 
+{
+  if (nr >= 0 && nr < STAT_SYSCALL_MAX)
+    hist_add (&syscall_hists[nr], cycles);
+}
+
+/* Formats every counter into BUF, which holds SIZE bytes, one
+   "NAME VALUE" line per counter and system call that has been
+   used, then one line per histogram and timed system call that
+   has any values, listing its count, mean and nonempty buckets,
+   then, with LOCK_PROFILE, one line for each of the most
+   contended locks.  Stores as much as fits followed by a null
+   terminator, like snprintf(), and returns the number of bytes
+   stored, not counting the null. */
+size_t
+stats_format (char *buf, size_t size) 
+{
+  struct stats_buf b;
+  int i;
+
+  b.buf = buf;
+  b.size = size;
+  b.len = 0;
+
+  for (i = 0; i < STAT_CNT; i++)
+    append (&b, "%s %"PRId64"\n", counter_names[i], stat_counters[i]);
+
+  for (i = 0; i < STAT_SYSCALL_MAX; i++)
+    if (syscall_cnts[i] != 0) 
+      {
+        if (syscall_names[i] != NULL)
+          append (&b, "syscall.%s %"PRId64"\n", syscall_names[i],
+                  syscall_cnts[i]);
+        else
+          append (&b, "syscall.%d %"PRId64"\n", i, syscall_cnts[i]);
+      }
+
+  for (i = 0; i < STAT_HIST_CNT; i++) 
+    if (histograms[i].cnt != 0) 
+      {
+        append (&b, "%s", histogram_names[i]);
+        append_histogram (&b, &histograms[i]);
+      }
+
+  for (i = 0; i < STAT_SYSCALL_MAX; i++)
+    if (syscall_hists[i].cnt != 0) 
+      {
+        if (syscall_names[i] != NULL)
+          append (&b, "syscall.%s.cycles", syscall_names[i]);
+        else
+          append (&b, "syscall.%d.cycles", i);
+        append_histogram (&b, &syscall_hists[i]);
+      }
+
+#ifdef LOCK_PROFILE
+  {
+    struct lock_stats top[STAT_LOCK_TOP];
+    int n = lock_profile_top (top, STAT_LOCK_TOP);
+
+    for (i = 0; i < n; i++)
+      append (&b, "lock.%s acquires=%"PRId64" contended=%"PRId64
+              " wait=%"PRIu64" max_wait=%"PRIu64" max_hold=%"PRIu64"\n",
+              top[i].name, top[i].acquire_cnt, top[i].contended_cnt,
+              top[i].wait_cycles, top[i].max_wait_cycles,
+              top[i].max_hold_cycles);
+  }
+#endif
+
+  return b.len < size ? b.len : (size > 0 ? size - 1 : 0);
+}
+
+/* Prints every counter to the console. */
+void
+stats_print (void) 
+{
+  char *page = palloc_get_page (0);
+
+  if (page != NULL) 
+    {
+      stats_format (page, PGSIZE);
+      printf ("%s", page);
+      palloc_free_page (page);
+    }
+}
+
+/* Adds VALUE to HIST. */
+static void
+hist_add (struct histogram *hist, uint64_t value) 
+{
+  enum intr_level old_level;
+  int bucket = 0;
+
+  while (bucket < STAT_HIST_BUCKETS - 1 && value >> (bucket + 1) != 0)
+    bucket++;
+
+  old_level = intr_disable ();
+  hist->cnt++;
+  hist->sum += value;
+  hist->buckets[bucket]++;
+  intr_set_level (old_level);
+}
+
+/* Appends FORMAT, formatted as by printf(), to B, storing as much
+   as fits. */
+static void
+append (struct stats_buf *b, const char *format, ...) 
+{
+  va_list args;
+  size_t room = b->len < b->size ? b->size - b->len : 0;
+
+  va_start (args, format);
+  b->len += vsnprintf (b->buf + (room > 0 ? b->len : 0), room, format, args);
+  va_end (args);
+}
+
+/* Appends the count, mean and nonempty buckets of HIST, which
+   must not be empty, to B, and ends the line. */
+static void
+append_histogram (struct stats_buf *b, const struct histogram *hist) 
+{
+  int i;
+
+  append (b, " count=%"PRId64" mean=%"PRIu64, hist->cnt, hist->sum / hist->cnt);
+  for (i = 0; i < STAT_HIST_BUCKETS; i++)
+    if (hist->buckets[i] != 0)
+      append (b, " 2^%d=%"PRId64, i, hist->buckets[i]);
+  append (b, "\n");
+}
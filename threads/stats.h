@@ -0,0 +1,63 @@
+#ifndef THREADS_STATS_H
+#define THREADS_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+
+/* Kernel-wide performance counters.
+
+   Every counter and histogram is named in one table in stats.c,
+   so that stats_format() can dump them all, at shutdown or live
+   through the stats system call.  A thread can be preempted in
+   the middle of a 64-bit read-modify-write, so every update is
+   made with interrupts off, which on a uniprocessor is enough
+   that none is lost.  Readers do not bother: stats_format() may
+   see a histogram or a 64-bit value half updated. */
+
+/* Event counters. */
+enum stat_counter
+  {
+    STAT_PAGE_FAULTS,           /* Page faults taken. */
+    STAT_EVICTIONS,             /* Frames evicted to swap. */
+    STAT_SWAP_INS,              /* Pages read back from swap. */
+    STAT_SWAP_OUTS,             /* Pages written to swap. */
+    STAT_LOCK_WAITS,            /* lock_acquire() calls that blocked. */
+    STAT_CNT
+  };
+
+/* Histograms, of cycle counts unless noted. */
+enum stat_histogram
+  {
+    STAT_HIST_BLOCK_READ,       /* Cycles per block_read(). */
+    STAT_HIST_BLOCK_WRITE,      /* Cycles per block_write(). */
+    STAT_HIST_CNT
+  };
+
+/* Number of buckets in a histogram.  Bucket I counts values
+   from 2**I up to 2**(I+1), except that bucket 0 also counts 0
+   and the last bucket counts everything above. */
+#define STAT_HIST_BUCKETS 32
+
+/* Most system call numbers counted separately. */
+#define STAT_SYSCALL_MAX 64
+
+extern int64_t stat_counters[STAT_CNT];
+
+/* Adds 1 to counter C. */
+static inline void
+stat_inc (enum stat_counter c) 
+{
+  enum intr_level old_level = intr_disable ();
+  stat_counters[c]++;
+  intr_set_level (old_level);
+}
+
+int64_t stat_get (enum stat_counter);
+void stat_record (enum stat_histogram, uint64_t value);
+void stat_syscall (int nr);
+void stat_syscall_time (int nr, uint64_t cycles);
+size_t stats_format (char *buf, size_t size);
+void stats_print (void);
+
+#endif /* threads/stats.h */
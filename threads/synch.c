@@ -27,9 +27,12 @@
 */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
+#include <tsc.h>
 #include "threads/interrupt.h"
+#include "threads/stats.h"
 #include "threads/thread.h"
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
@@ -179,8 +182,113 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+#ifdef LOCK_PROFILE
+  memset (&lock->stats, 0, sizeof lock->stats);
+  lock->acquire_time = 0;
+#endif
 }
 
+#ifdef LOCK_PROFILE
+/* Locks named by lock_set_name(), whose statistics are reported.
+   Protected by disabling interrupts. */
+static struct list named_locks = LIST_INITIALIZER (named_locks);
+
+/* Number of locks listed by lock_print_profile(). */
+#define LOCK_PROFILE_TOP 10
+
+static void profile_acquired (struct lock *, bool contended, uint64_t start);
+
+/* Names LOCK, which must live as long as the kernel runs, and
+   adds it to the locks whose contention is reported. */
+void
+lock_set_name (struct lock *lock, const char *name) 
+{
+  enum intr_level old_level;
+
+  ASSERT (lock != NULL);
+  ASSERT (name != NULL);
+
+  old_level = intr_disable ();
+  if (lock->stats.name == NULL)
+    list_push_back (&named_locks, &lock->profile_elem);
+  lock->stats.name = name;
+  intr_set_level (old_level);
+}
+
+/* Copies the statistics of the CNT named locks that have spent
+   the most time waiting into TOP, most first, and returns the
+   number copied, which is less than CNT if there are fewer
+   named locks. */
+int
+lock_profile_top (struct lock_stats top[], int cnt) 
+{
+  enum intr_level old_level;
+  struct list_elem *e;
+  int n = 0;
+
+  old_level = intr_disable ();
+  for (e = list_begin (&named_locks); e != list_end (&named_locks);
+       e = list_next (e)) 
+    {
+      struct lock *lock = list_entry (e, struct lock, profile_elem);
+      int i;
+
+      /* Insertion sort into TOP. */
+      for (i = n; i > 0 && top[i - 1].wait_cycles < lock->stats.wait_cycles;
+           i--)
+        if (i < cnt)
+          top[i] = top[i - 1];
+      if (i < cnt) 
+        {
+          top[i] = lock->stats;
+          if (n < cnt)
+            n++;
+        }
+    }
+  intr_set_level (old_level);
+
+  return n;
+}
+
+/* Prints the named locks that have spent the most time waiting. */
+void
+lock_print_profile (void) 
+{
+  struct lock_stats top[LOCK_PROFILE_TOP];
+  int n = lock_profile_top (top, LOCK_PROFILE_TOP);
+  int i;
+
+  printf ("Lock contention (cycles):\n");
+  for (i = 0; i < n; i++)
+    printf ("  %-12s %10"PRId64" acquires %8"PRId64" contended "
+            "%14"PRIu64" waited %12"PRIu64" max wait %12"PRIu64" max hold\n",
+            top[i].name, top[i].acquire_cnt, top[i].contended_cnt,
+            top[i].wait_cycles, top[i].max_wait_cycles,
+            top[i].max_hold_cycles);
+}
+
+/* Updates LOCK's statistics now that the current thread has
+   acquired it, after waiting since START if CONTENDED. */
+static void
+profile_acquired (struct lock *lock, bool contended, uint64_t start) 
+{
+  struct lock_stats *s = &lock->stats;
+  uint64_t now = rdtsc ();
+
+  s->acquire_cnt++;
+  if (contended) 
+    {
+      uint64_t wait = now - start;
+
+      s->contended_cnt++;
+      s->wait_cycles += wait;
+      if (wait > s->max_wait_cycles)
+        s->max_wait_cycles = wait;
+    }
+  lock->acquire_time = now;
+}
+#endif /* LOCK_PROFILE */
+
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
@@ -196,8 +304,18 @@ lock_acquire (struct lock *lock)
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+#ifdef LOCK_PROFILE
+  uint64_t start = rdtsc ();
+  bool contended = lock->holder != NULL;
+#endif
+
+  if (lock->holder != NULL)
+    stat_inc (STAT_LOCK_WAITS);
   sema_down (&lock->semaphore);
   lock->holder = thread_current ();
+#ifdef LOCK_PROFILE
+  profile_acquired (lock, contended, start);
+#endif
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -215,8 +333,13 @@ lock_try_acquire (struct lock *lock)
   ASSERT (!lock_held_by_current_thread (lock));
 
   success = sema_try_down (&lock->semaphore);
-  if (success)
-    lock->holder = thread_current ();
+  if (success) 
+    {
+      lock->holder = thread_current ();
+#ifdef LOCK_PROFILE
+      profile_acquired (lock, false, 0);
+#endif
+    }
   return success;
 }
 
@@ -231,6 +354,12 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+#ifdef LOCK_PROFILE
+  uint64_t hold = rdtsc () - lock->acquire_time;
+  if (hold > lock->stats.max_hold_cycles)
+    lock->stats.max_hold_cycles = hold;
+#endif
+
   lock->holder = NULL;
   sema_up (&lock->semaphore);
 }
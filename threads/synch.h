@@ -1,8 +1,10 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <debug.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore 
@@ -17,14 +19,47 @@ bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
 
+#ifdef LOCK_PROFILE
+/* Contention statistics for one lock, kept when the kernel is
+   built with LOCK_PROFILE defined (e.g. "make LOCK_PROFILE=1").
+   They are only updated by the lock's holder, so the lock itself
+   protects them. */
+struct lock_stats
+  {
+    const char *name;           /* Name given by lock_set_name(). */
+    int64_t acquire_cnt;        /* Number of acquisitions. */
+    int64_t contended_cnt;      /* Acquisitions that had to wait. */
+    uint64_t wait_cycles;       /* Total cycles spent waiting. */
+    uint64_t max_wait_cycles;   /* Longest wait. */
+    uint64_t max_hold_cycles;   /* Longest time held. */
+  };
+#endif
+
 /* Lock. */
 struct lock 
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+#ifdef LOCK_PROFILE
+    struct lock_stats stats;    /* Contention statistics. */
+    uint64_t acquire_time;      /* rdtsc() when last acquired. */
+    struct list_elem profile_elem; /* Element in list of named locks. */
+#endif
   };
 
 void lock_init (struct lock *);
+#ifdef LOCK_PROFILE
+void lock_set_name (struct lock *, const char *name);
+int lock_profile_top (struct lock_stats top[], int cnt);
+void lock_print_profile (void);
+#else
+/* Names LOCK in contention reports.  Does nothing unless the
+   kernel is built with LOCK_PROFILE. */
+static inline void
+lock_set_name (struct lock *lock UNUSED, const char *name UNUSED) 
+{
+}
+#endif
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
@@ -14,6 +14,7 @@
 #include "threads/vaddr.h"
 // #ifdef USERPROG
 #include "userprog/process.h"
+#include "userprog/fdtable.h"
 // #endif
 #include "vm/page.h"
 
@@ -30,6 +31,24 @@ static struct list ready_list;
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
+/* Threads indexed by tid, so that thread_get() does not have to
+   walk all_list.  A thread is added to its bucket as soon as its
+   tid is assigned and removed when it leaves all_list.  Tids are
+   handed out sequentially, so the low bits of a tid spread live
+   threads evenly across the buckets. */
+#define TID_BUCKET_CNT 256
+static struct list tid_buckets[TID_BUCKET_CNT];
+
+/* Pages of threads that have exited, kept for reuse by
+   thread_create() so that spawning does not have to go back to
+   the page allocator every time.  At most THREAD_CACHE_MAX pages
+   are kept; the rest are freed.  A cached page is linked through
+   its old allelem, which is no longer on all_list.  Protected by
+   disabling interrupts. */
+#define THREAD_CACHE_MAX 16
+static struct list thread_cache;
+static size_t thread_cache_cnt;
+
 /* Idle thread. */
 static struct thread *idle_thread;
 
@@ -72,6 +91,10 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static struct thread *thread_page_get (void);
+static void thread_page_free (struct thread *);
+static struct list *tid_bucket (tid_t);
+static void tid_index_insert (struct thread *);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -89,17 +112,24 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  size_t i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
+  lock_set_name (&tid_lock, "tid");
   list_init (&ready_list);
   list_init (&all_list);
+  list_init (&thread_cache);
+  for (i = 0; i < TID_BUCKET_CNT; i++)
+    list_init (&tid_buckets[i]);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
+  tid_index_insert (initial_thread);
   vm_page_table_init(&initial_thread->spt);
 }
 
@@ -179,13 +209,14 @@ thread_create (const char *name, int priority,
   parent = thread_current();
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = thread_page_get ();
   if (t == NULL)
     return TID_ERROR;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  tid_index_insert (t);
   t->parent_tid = parent->tid;
   list_init(&(t->child_processes));
 
@@ -196,6 +227,7 @@ thread_create (const char *name, int priority,
   }
   struct child_process *new_child = child_process_init(tid); 
   list_push_back(&(parent->child_processes), &(new_child->elem));
+  t->child_info = new_child;
 
   /*
   printf("(thread_create) parent thread tid: %d\n", parent->tid);
@@ -217,16 +249,8 @@ thread_create (const char *name, int priority,
   sf->eip = switch_entry;
   sf->ebp = 0;
 
-  /* Allocate space for open file list. */
-  t->open_files = (struct file_list*) malloc(sizeof(struct file_list));
-  t->open_files->size = 2; /* For STDIN and STDOUT. These fd's can never be altered. */
-  t->open_files->files = (struct file**) malloc(sizeof(struct file*) * t->open_files->size);
-  t->open_files->isOpen = (bool*) malloc(sizeof(bool) * t->open_files->size);
-  int i;
-  for (i = 0; i < t->open_files->size; i++){
-      t->open_files->isOpen[i] = true;
-      t->open_files->files[i] = NULL;
-  }
+  /* Start with only the console descriptors. */
+  fd_table_init (&t->fds);
 
   /* Initialize supplemental page table */
   vm_page_table_init(&t->spt);
@@ -301,22 +325,32 @@ thread_current (void)
   return t;
 }
 
+/* Returns the live thread whose tid is TID, or a null pointer
+   if there is no such thread.  Only the bucket for TID is
+   searched, so the cost does not grow with the number of
+   threads in the system. */
 struct thread *
 thread_get (tid_t tid)
 {
+  struct list *bucket = tid_bucket (tid);
+  struct thread *found = NULL;
+  enum intr_level old_level;
   struct list_elem *e;
 
-  for (e = list_begin (&all_list); e != list_end (&all_list);
+  old_level = intr_disable ();
+  for (e = list_begin (bucket); e != list_end (bucket);
        e = list_next (e))
     {
-      struct thread *t = list_entry (e, struct thread, allelem);
+      struct thread *t = list_entry (e, struct thread, tidelem);
       if (t->tid == tid)
         {
-          return t;
+          found = t;
+          break;
         }
     }
+  intr_set_level (old_level);
 
-  return NULL;
+  return found;
 }
 
 /* Returns the running thread's tid. */
@@ -341,6 +375,7 @@ thread_exit (void)
      when it calls thread_schedule_tail(). */
   intr_disable ();
   list_remove (&thread_current()->allelem);
+  list_remove (&thread_current()->tidelem);
   thread_current ()->status = THREAD_DYING;
 	schedule ();
   NOT_REACHED ();
@@ -599,7 +634,7 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      thread_page_free (prev);
     }
 }
 
@@ -639,6 +674,66 @@ allocate_tid (void)
 
   return tid;
 }
+
+/* Returns a page to hold a new thread, taken from the thread
+   cache if possible, otherwise from the page allocator.  The page
+   is not zeroed: init_thread() clears the struct thread at its
+   base, and the rest of the page is kernel stack.  Returns a null
+   pointer if no page is available. */
+static struct thread *
+thread_page_get (void)
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (!list_empty (&thread_cache))
+    {
+      t = list_entry (list_pop_front (&thread_cache), struct thread, allelem);
+      thread_cache_cnt--;
+    }
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    t = palloc_get_page (0);
+  return t;
+}
+
+/* Releases the page of dead thread T, keeping it in the thread
+   cache if there is room.  Must be called with interrupts off. */
+static void
+thread_page_free (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->magic = 0;
+  if (thread_cache_cnt < THREAD_CACHE_MAX)
+    {
+      list_push_front (&thread_cache, &t->allelem);
+      thread_cache_cnt++;
+    }
+  else
+    palloc_free_page (t);
+}
+
+/* Returns the tid_buckets[] list that TID hashes into. */
+static struct list *
+tid_bucket (tid_t tid)
+{
+  return &tid_buckets[(unsigned) tid % TID_BUCKET_CNT];
+}
+
+/* Adds T, whose tid has just been assigned, to the tid index. */
+static void
+tid_index_insert (struct thread *t)
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  list_push_back (tid_bucket (t->tid), &t->tidelem);
+  intr_set_level (old_level);
+}
+
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof (struct thread, stack);
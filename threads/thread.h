@@ -82,15 +82,18 @@ typedef int tid_t;
    ready state is on the run queue, whereas only a thread in the
    blocked state is on a semaphore wait list. */
 
-/* Struct handling the current process's open files. */
-struct file_list
-{
-    struct file** files;                /* Array of open process files, defined in filesys/file.c. */
-    bool* isOpen;                      /* Array corresponding to files array, denoting if given entry is valid, 
-                                          open file (the files array may have holes from closures). */
-    int size;                          /* Number of memory allocated spaces in files array.
-                                          can never be < 3, due to STDIN, STDOUT, STDERR. */ 
-};
+/* A process's file descriptor table.  Slot FD of ENTRIES says what
+   is open as FD, and bit FD of USED is set if FD is taken.  Both
+   grow by doubling, and are only allocated when the process first
+   uses a descriptor.  Descriptors 0 and 1 start out open on the
+   console.  See userprog/fdtable.c. */
+struct fd_table
+  {
+    struct fd_entry *entries;           /* Open descriptors, by fd. */
+    struct bitmap *used;                /* Descriptors in use. */
+    int size;                           /* Number of slots. */
+    int lowest_free;                    /* No free fd below this one. */
+  };
 
 struct thread
   {
@@ -101,6 +104,7 @@ struct thread
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
     struct list_elem allelem;           /* List element for all threads list. */
+    struct list_elem tidelem;           /* List element for tid index bucket. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
@@ -111,8 +115,9 @@ struct thread
 #endif
     tid_t parent_tid;                   /* Keep track of parent. */
     struct list child_processes;        /* Keep track of all children. */
+    struct child_process *child_info;   /* Own entry in parent's child_processes. */
 
-    struct file_list* open_files;       /* Process file list. */
+    struct fd_table fds;                /* Open file descriptors. */
 
     struct list spt;                    /* Supplemental page table */
 
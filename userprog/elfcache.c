@@ -0,0 +1,123 @@
+#include "userprog/elfcache.h"
+#include <debug.h>
+#include <list.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Most executables whose headers are cached at once. */
+#define ELF_CACHE_SIZE 16
+
+/* Cache of parsed and validated executable headers, so that
+   exec()ing a program again need not read and check its ELF and
+   program headers.  Entries are found by the sector of the
+   executable's inode, kept in most recently used order, and
+   dropped when the file is written or deleted. */
+struct cached_image
+  {
+    struct list_elem elem;      /* Element in image_list. */
+    block_sector_t sector;      /* Sector of the file's inode. */
+    struct elf_image image;     /* Parsed headers. */
+  };
+
+static struct list image_list;  /* Most recently used first. */
+static int image_cnt;           /* Number of entries in image_list. */
+static struct lock cache_lock;
+
+static struct cached_image *lookup (block_sector_t sector);
+
+/* Initializes the executable header cache. */
+void
+elf_cache_init (void)
+{
+  list_init (&image_list);
+  image_cnt = 0;
+  lock_init (&cache_lock);
+  lock_set_name (&cache_lock, "elfcache");
+}
+
+/* Copies the cached headers of the executable whose inode is at
+   INODE_SECTOR into IMAGE and returns true, or returns false if
+   they are not cached. */
+bool
+elf_cache_lookup (block_sector_t inode_sector, struct elf_image *image)
+{
+  struct cached_image *c;
+
+  lock_acquire (&cache_lock);
+  c = lookup (inode_sector);
+  if (c != NULL)
+    {
+      list_remove (&c->elem);
+      list_push_front (&image_list, &c->elem);
+      memcpy (image, &c->image, sizeof *image);
+    }
+  lock_release (&cache_lock);
+
+  return c != NULL;
+}
+
+/* Caches IMAGE as the headers of the executable whose inode is at
+   INODE_SECTOR, replacing the least recently used entry if the
+   cache is full.  Does nothing if memory is not available. */
+void
+elf_cache_insert (block_sector_t inode_sector, const struct elf_image *image)
+{
+  struct cached_image *c = malloc (sizeof *c);
+  struct cached_image *old = NULL;
+
+  if (c == NULL)
+    return;
+  c->sector = inode_sector;
+  memcpy (&c->image, image, sizeof *image);
+
+  lock_acquire (&cache_lock);
+  old = lookup (inode_sector);
+  if (old != NULL)
+    list_remove (&old->elem);
+  else if (image_cnt == ELF_CACHE_SIZE)
+    old = list_entry (list_pop_back (&image_list), struct cached_image, elem);
+  else
+    image_cnt++;
+  list_push_front (&image_list, &c->elem);
+  lock_release (&cache_lock);
+
+  free (old);
+}
+
+/* Drops the cached headers of the file whose inode is at
+   INODE_SECTOR, if any, because the file is being written or its
+   sectors freed. */
+void
+elf_cache_invalidate (block_sector_t inode_sector)
+{
+  struct cached_image *c;
+
+  lock_acquire (&cache_lock);
+  c = lookup (inode_sector);
+  if (c != NULL)
+    {
+      list_remove (&c->elem);
+      image_cnt--;
+    }
+  lock_release (&cache_lock);
+
+  free (c);
+}
+
+/* Returns the entry for INODE_SECTOR, or a null pointer.  Must be
+   called with cache_lock held. */
+static struct cached_image *
+lookup (block_sector_t sector)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&image_list); e != list_end (&image_list);
+       e = list_next (e))
+    {
+      struct cached_image *c = list_entry (e, struct cached_image, elem);
+      if (c->sector == sector)
+        return c;
+    }
+  return NULL;
+}
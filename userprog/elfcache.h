@@ -0,0 +1,35 @@
+#ifndef USERPROG_ELFCACHE_H
+#define USERPROG_ELFCACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/block.h"
+
+/* Most loadable segments in an executable. */
+#define ELF_MAX_SEGMENTS 16
+
+/* One loadable segment, already validated, as load_segment()
+   takes it. */
+struct elf_segment
+  {
+    uint32_t file_page;         /* Page-aligned offset in the file. */
+    uint32_t mem_page;          /* Page-aligned user virtual address. */
+    uint32_t read_bytes;        /* Bytes to read from the file. */
+    uint32_t zero_bytes;        /* Bytes to zero after them. */
+    bool writable;              /* Mapped writable? */
+  };
+
+/* What load() needs from an executable's headers. */
+struct elf_image
+  {
+    void (*entry) (void);       /* Entry point. */
+    int seg_cnt;                /* Number of segments. */
+    struct elf_segment segs[ELF_MAX_SEGMENTS];
+  };
+
+void elf_cache_init (void);
+bool elf_cache_lookup (block_sector_t inode_sector, struct elf_image *);
+void elf_cache_insert (block_sector_t inode_sector, const struct elf_image *);
+void elf_cache_invalidate (block_sector_t inode_sector);
+
+#endif /* userprog/elfcache.h */
@@ -3,16 +3,15 @@
 #include <stdio.h>
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
+#include "userprog/uaccess.h"
 #include "threads/interrupt.h"
+#include "threads/stats.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "vm/page.h"
 #include "vm/frame.h"
 
 
-/* Number of page faults processed. */
-static long long page_fault_cnt;
-
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
@@ -69,7 +68,7 @@ exception_init (void)
 void
 exception_print_stats (void) 
 {
-  printf ("Exception: %lld page faults\n", page_fault_cnt);
+  printf ("Exception: %"PRId64" page faults\n", stat_get (STAT_PAGE_FAULTS));
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -147,7 +146,7 @@ page_fault (struct intr_frame *f)
   intr_enable ();
 
   /* Count page faults. */
-  page_fault_cnt++;
+  stat_inc (STAT_PAGE_FAULTS);
 
   /* Determine cause. */
   not_present = (f->error_code & PF_P) == 0;
@@ -156,7 +155,7 @@ page_fault (struct intr_frame *f)
 
 #if debugpfault
   printf("Faulting address: %p\n", fault_addr);
-  printf("Page fault count: %d\n", page_fault_cnt);
+  printf("Page fault count: %"PRId64"\n", stat_get (STAT_PAGE_FAULTS));
 #endif
 
   /* Page fault occurred by read/write in user virtual memory
@@ -172,19 +171,26 @@ page_fault (struct intr_frame *f)
           success = load_spte(spte);
         }
 
-      /* Grow stack */
-      else if ((unsigned int) fault_addr > HEAP_STACK_DIVIDE)
+      /* Grow stack. Cannot read from unallocated stack space. */
+      else if ((unsigned int) fault_addr > HEAP_STACK_DIVIDE && write)
+        {
+          success = alloc_blank_spte (fault_addr);
+        }
+    }
+
+  /* A fault on a user address that the kernel took while copying
+     to or from user memory: resume at the copy's recovery point
+     and make it report failure.  Faults at any other kernel
+     instruction are bugs and fall through.  See
+     userprog/uaccess.c. */
+  if (!success && !user && is_user_vaddr (fault_addr))
+    {
+      uintptr_t fixup = uaccess_fixup ((uintptr_t) f->eip);
+      if (fixup != 0)
         {
-          if (write) 
-            {
-              success = alloc_blank_spte (fault_addr);
-            }
-
-          /* Cannot read from unallocated stack space */
-          else 
-            {
-							exit(-1);
-            }
+          f->eip = (void (*) (void)) fixup;
+          f->eax = 0xffffffff;
+          return;
         }
     }
 
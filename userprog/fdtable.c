@@ -0,0 +1,290 @@
+#include "userprog/fdtable.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall-nr.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "userprog/pipe.h"
+#include "userprog/syscall.h"
+
+/* Number of slots in a descriptor table when it is first
+   allocated. */
+#define FD_TABLE_INITIAL_SIZE 16
+
+/* Descriptors opened on the console when the table is first
+   allocated. */
+#define FD_RESERVED 2
+
+static bool grow (struct fd_table *);
+static bool dup_entry (struct fd_entry *dst, const struct fd_entry *src);
+static void close_entry (struct fd_entry *);
+
+/* Initializes T as a table with only the console descriptors
+   open.  Nothing is allocated until a descriptor is first used. */
+void
+fd_table_init (struct fd_table *t) 
+{
+  t->entries = NULL;
+  t->used = NULL;
+  t->size = 0;
+  t->lowest_free = FD_RESERVED;
+}
+
+/* Closes everything open in T and frees T's storage, leaving it
+   as fd_table_init() does. */
+void
+fd_table_destroy (struct fd_table *t) 
+{
+  int fd;
+
+  for (fd = 0; fd < t->size; fd++)
+    close_entry (&t->entries[fd]);
+
+  free (t->entries);
+  bitmap_destroy (t->used);
+  fd_table_init (t);
+}
+
+/* Fills DST, which must be as fd_table_init() leaves it, with
+   duplicates of everything open in SRC, at the same descriptors,
+   except descriptors marked O_CLOEXEC.  Returns false, leaving DST empty again, if memory runs out. */
+bool
+fd_table_copy (struct fd_table *dst, struct fd_table *src) 
+{
+  int fd;
+
+  ASSERT (dst->entries == NULL);
+
+  if (src->used == NULL)
+    return true;
+
+  dst->entries = calloc (src->size, sizeof *dst->entries);
+  dst->used = bitmap_create (src->size);
+  if (dst->entries == NULL || dst->used == NULL)
+    {
+      fd_table_destroy (dst);
+      return false;
+    }
+  dst->size = src->size;
+  dst->lowest_free = 0;
+
+  for (fd = 0; fd < src->size; fd++)
+    if (src->entries[fd].type != FD_NONE
+        && !(src->entries[fd].flags & O_CLOEXEC))
+      {
+        if (!dup_entry (&dst->entries[fd], &src->entries[fd]))
+          {
+            fd_table_destroy (dst);
+            return false;
+          }
+        bitmap_mark (dst->used, fd);
+      }
+  return true;
+}
+
+/* Assigns the lowest free descriptor in T to a copy of E and
+   returns it, or returns -1 if memory for a larger table is not
+   available. */
+int
+fd_alloc (struct fd_table *t, const struct fd_entry *e) 
+{
+  size_t fd;
+
+  ASSERT (e->type != FD_NONE);
+
+  if (t->used == NULL && !grow (t))
+    return -1;
+
+  /* Every slot below lowest_free is taken, so the search can
+     start there. */
+  fd = bitmap_scan (t->used, t->lowest_free, 1, false);
+  if (fd == BITMAP_ERROR)
+    {
+      fd = t->size;
+      if (fd >= FD_MAX || !grow (t))
+        return -1;
+    }
+
+  bitmap_mark (t->used, fd);
+  t->entries[fd] = *e;
+  t->lowest_free = fd + 1;
+  return fd;
+}
+
+/* Returns the entry for FD in T, or a null pointer if FD is not
+   open.  The entry is only valid until the next fd_alloc() on T.
+   Looking up a console descriptor allocates T if need be, so that
+   its flags have somewhere to live. */
+struct fd_entry *
+fd_lookup (struct fd_table *t, int fd) 
+{
+  if (fd < 0)
+    return NULL;
+  if (t->used == NULL && fd < FD_RESERVED && !grow (t))
+    return NULL;
+  if (fd >= t->size || t->entries[fd].type == FD_NONE)
+    return NULL;
+  return &t->entries[fd];
+}
+
+/* Returns the file open as FD in T, or a null pointer if FD is
+   not open on a file. */
+struct file *
+fd_file (struct fd_table *t, int fd) 
+{
+  if (fd < FD_RESERVED && t->used == NULL)
+    return NULL;
+  else
+    {
+      struct fd_entry *e = fd_lookup (t, fd);
+      return e != NULL && e->type == FD_FILE ? e->file : NULL;
+    }
+}
+
+/* Makes descriptor NEWFD in T refer to a duplicate of what FD
+   refers to, first closing NEWFD if it is open, or uses the lowest
+   free descriptor if NEWFD is negative.  The new descriptor does
+   not inherit O_CLOEXEC.  Returns the new descriptor, or -1 if FD
+   is not open, NEWFD is FD_MAX or more, or memory runs out.  Does
+   nothing but return NEWFD if it equals FD. */
+int
+fd_dup (struct fd_table *t, int fd, int newfd) 
+{
+  struct fd_entry *e = fd_lookup (t, fd);
+  struct fd_entry copy;
+
+  if (e == NULL || newfd >= FD_MAX)
+    return -1;
+  if (newfd == fd)
+    return newfd;
+  if (!dup_entry (&copy, e))
+    return -1;
+  copy.flags &= ~O_CLOEXEC;
+
+  if (newfd < 0)
+    {
+      newfd = fd_alloc (t, &copy);
+      if (newfd < 0)
+        close_entry (&copy);
+      return newfd;
+    }
+
+  fd_release (t, newfd);
+  while (newfd >= t->size)
+    if (!grow (t))
+      {
+        close_entry (&copy);
+        return -1;
+      }
+  bitmap_mark (t->used, newfd);
+  t->entries[newfd] = copy;
+  return newfd;
+}
+
+/* Closes descriptor FD in T, along with the file or pipe end open
+   as FD.  Returns false if FD was not open. */
+bool
+fd_release (struct fd_table *t, int fd) 
+{
+  struct fd_entry *e = fd_lookup (t, fd);
+
+  if (e == NULL)
+    return false;
+
+  close_entry (e);
+  bitmap_reset (t->used, fd);
+  if (fd < t->lowest_free)
+    t->lowest_free = fd;
+  return true;
+}
+
+/* Fills DST with a new reference to whatever SRC refers to, with
+   the same flags.  A file is reopened, so the duplicate has its own
+   position.  Returns false, leaving DST not open, if memory runs
+   out. */
+static bool
+dup_entry (struct fd_entry *dst, const struct fd_entry *src) 
+{
+  *dst = *src;
+  switch (src->type)
+    {
+    case FD_FILE:
+      lock_acquire (&file_lock);
+      dst->file = file_reopen (src->file);
+      lock_release (&file_lock);
+      if (dst->file == NULL)
+        {
+          dst->type = FD_NONE;
+          return false;
+        }
+      return true;
+
+    case FD_PIPE_READ:
+    case FD_PIPE_WRITE:
+      pipe_dup (src->pipe, src->type == FD_PIPE_WRITE);
+      return true;
+
+    default:
+      return true;
+    }
+}
+
+/* Closes whatever E refers to and marks it not open. */
+static void
+close_entry (struct fd_entry *e) 
+{
+  switch (e->type)
+    {
+    case FD_FILE:
+      lock_acquire (&file_lock);
+      file_close (e->file);
+      lock_release (&file_lock);
+      break;
+
+    case FD_PIPE_READ:
+    case FD_PIPE_WRITE:
+      pipe_close (e->pipe, e->type == FD_PIPE_WRITE);
+      break;
+
+    default:
+      break;
+    }
+  memset (e, 0, sizeof *e);
+}
+
+/* Doubles the size of T, or allocates its first slots with the
+   console descriptors open.  Returns false if out of memory. */
+static bool
+grow (struct fd_table *t) 
+{
+  int new_size = t->size > 0 ? t->size * 2 : FD_TABLE_INITIAL_SIZE;
+  struct fd_entry *entries;
+  struct bitmap *used;
+  int fd;
+
+  entries = realloc (t->entries, new_size * sizeof *entries);
+  if (entries == NULL)
+    return false;
+  t->entries = entries;
+
+  used = bitmap_create (new_size);
+  if (used == NULL)
+    return false;
+
+  memset (entries + t->size, 0, (new_size - t->size) * sizeof *entries);
+  if (t->size == 0)
+    {
+      entries[STDIN_FILENO].type = FD_CONSOLE_IN;
+      entries[STDOUT_FILENO].type = FD_CONSOLE_OUT;
+    }
+  for (fd = 0; fd < new_size; fd++)
+    if (entries[fd].type != FD_NONE)
+      bitmap_mark (used, fd);
+
+  bitmap_destroy (t->used);
+  t->used = used;
+  t->size = new_size;
+  return true;
+}
@@ -0,0 +1,42 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include "threads/thread.h"
+
+struct file;
+struct pipe;
+
+/* Descriptors are numbered below this.  Bounds how large a
+   process can make its table, e.g. with dup2(). */
+#define FD_MAX 1024
+
+/* What a file descriptor refers to. */
+enum fd_type
+  {
+    FD_NONE,                    /* Not open. */
+    FD_CONSOLE_IN,              /* Keyboard or serial input. */
+    FD_CONSOLE_OUT,             /* Console output. */
+    FD_FILE,                    /* File in the file system. */
+    FD_PIPE_READ,               /* Reading end of a pipe. */
+    FD_PIPE_WRITE               /* Writing end of a pipe. */
+  };
+
+/* One open file descriptor. */
+struct fd_entry
+  {
+    enum fd_type type;          /* What is open. */
+    int flags;                  /* O_NONBLOCK, O_CLOEXEC. */
+    struct file *file;          /* For FD_FILE. */
+    struct pipe *pipe;          /* For FD_PIPE_READ, FD_PIPE_WRITE. */
+  };
+
+void fd_table_init (struct fd_table *);
+void fd_table_destroy (struct fd_table *);
+bool fd_table_copy (struct fd_table *dst, struct fd_table *src);
+int fd_alloc (struct fd_table *, const struct fd_entry *);
+struct fd_entry *fd_lookup (struct fd_table *, int fd);
+struct file *fd_file (struct fd_table *, int fd);
+int fd_dup (struct fd_table *, int fd, int newfd);
+bool fd_release (struct fd_table *, int fd);
+
+#endif /* userprog/fdtable.h */
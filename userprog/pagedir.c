@@ -1,13 +1,31 @@
 #include "userprog/pagedir.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 
+/* Most pages pagedir_clear_pages() invalidates one at a time;
+   past this, reloading CR3 is cheaper than that many INVLPGs. */
+#define INVLPG_MAX 32
+
+/* Page directory whose address is in CR3, or a null pointer if
+   pagedir_activate() has not been called yet. */
+static uint32_t *loaded_pd;
+
+/* TLB statistics. */
+static long long cr3_load_cnt;      /* # of CR3 loads. */
+static long long cr3_skip_cnt;      /* # of CR3 loads avoided. */
+static long long tlb_flush_cnt;     /* # of whole-TLB invalidations. */
+static long long invlpg_cnt;        /* # of single-page invalidations. */
+
 static uint32_t *active_pd (void);
+static void load_pd (uint32_t *);
 static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -27,12 +45,20 @@ pagedir_create (void)
 void
 pagedir_destroy (uint32_t *pd) 
 {
+  enum intr_level old_level;
   uint32_t *pde;
 
   if (pd == NULL)
     return;
 
   ASSERT (pd != init_page_dir);
+
+  /* A kernel thread may still be borrowing PD. */
+  old_level = intr_disable ();
+  if (pd == loaded_pd)
+    load_pd (init_page_dir);
+  intr_set_level (old_level);
+
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
     if (*pde & PTE_P) 
       {
@@ -175,10 +201,46 @@ pagedir_clear_page (uint32_t *pd, void *upage)
     {
       // printf ("Cleared virtual PTE: %p\n", upage);
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
+/* Marks the CNT user virtual pages in PAGES "not present" in page
+   directory PD, as pagedir_clear_page() would, but invalidates the
+   TLB once for the whole batch: page by page for a small batch,
+   all at once for a large one.  Pages that were not present are
+   not invalidated. */
+void
+pagedir_clear_pages (uint32_t *pd, void *const pages[], size_t cnt) 
+{
+  void *cleared[INVLPG_MAX];
+  size_t cleared_cnt = 0;
+  size_t i;
+
+  for (i = 0; i < cnt; i++) 
+    {
+      uint32_t *pte;
+
+      ASSERT (pg_ofs (pages[i]) == 0);
+      ASSERT (is_user_vaddr (pages[i]));
+
+      pte = lookup_page (pd, pages[i], false);
+      if (pte != NULL && (*pte & PTE_P) != 0)
+        {
+          *pte &= ~PTE_P;
+          if (cleared_cnt < INVLPG_MAX)
+            cleared[cleared_cnt] = pages[i];
+          cleared_cnt++;
+        }
+    }
+
+  if (cleared_cnt > INVLPG_MAX)
+    invalidate_pagedir (pd);
+  else
+    for (i = 0; i < cleared_cnt; i++)
+      invalidate_page (pd, cleared[i]);
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
    that is, if the page has been modified since the PTE was
    installed.
@@ -203,7 +265,7 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -232,7 +294,7 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -242,15 +304,48 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
 void
 pagedir_activate (uint32_t *pd) 
 {
+  enum intr_level old_level;
+
   if (pd == NULL)
     pd = init_page_dir;
 
+  /* Every page directory maps the kernel identically, so loading
+     the one that is already loaded would only flush the TLB. */
+  old_level = intr_disable ();
+  if (pd != loaded_pd)
+    load_pd (pd);
+  else
+    cr3_skip_cnt++;
+  intr_set_level (old_level);
+}
+
+/* Prints TLB statistics. */
+void
+pagedir_print_stats (void) 
+{
+  printf ("TLB: %lld CR3 loads (%lld skipped), %lld full flushes, "
+          "%lld single-page flushes\n",
+          cr3_load_cnt, cr3_skip_cnt, tlb_flush_cnt, invlpg_cnt);
+}
+
+/* Loads page directory PD into CR3, which also flushes the TLB.
+   Interrupts are off throughout, so that a thread preempted
+   between the load and the bookkeeping cannot leave loaded_pd
+   naming a page directory that is no longer in CR3. */
+static void
+load_pd (uint32_t *pd) 
+{
+  enum intr_level old_level = intr_disable ();
+
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base
      Address of the Page Directory". */
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
+  loaded_pd = pd;
+  cr3_load_cnt++;
+  intr_set_level (old_level);
 }
 
 /* Returns the currently active page directory. */
@@ -277,10 +372,30 @@ active_pd (void)
 static void
 invalidate_pagedir (uint32_t *pd) 
 {
+  enum intr_level old_level = intr_disable ();
+
   if (active_pd () == pd) 
     {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
+      /* Reloading PD clears the TLB.  See [IA32-v3a] 3.12
          "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
+      load_pd (pd);
+      tlb_flush_cnt++;
     } 
+  intr_set_level (old_level);
+}
+
+/* Invalidates the TLB entry for virtual page VPAGE if PD is the
+   active page directory, leaving the rest of the TLB alone.  See
+   [IA32-v2a] "INVLPG--Invalidate TLB Entry". */
+static void
+invalidate_page (uint32_t *pd, const void *vpage) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (active_pd () == pd) 
+    {
+      asm volatile ("invlpg (%0)" : : "r" (vpage) : "memory");
+      invlpg_cnt++;
+    }
+  intr_set_level (old_level);
 }
@@ -0,0 +1,290 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall-nr.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/pollq.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
+#include "vm/page.h"
+
+/* Bytes of data a pipe can hold: one page. */
+#define PIPE_SIZE PGSIZE
+
+/* An anonymous pipe: a ring buffer with any number of reading and
+   writing ends, counting descriptors inherited across exec().
+   Freed when the last end is closed.
+
+   Data is copied once, straight between the ring and the user's
+   buffer.  At most PIPE_SIZE bytes of the user buffer are pinned
+   at a time, so that they cannot fault while the pipe's lock is
+   held, and a reader or writer blocked on the pipe keeps no more
+   than two pages pinned. */
+struct pipe
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition not_empty; /* Data arrived or last writer left. */
+    struct condition not_full;  /* Space freed or last reader left. */
+    struct pollq pollers;       /* Woken on any change. */
+    int readers;                /* Open reading ends. */
+    int writers;                /* Open writing ends. */
+    size_t head;                /* Offset of the oldest byte in BUF. */
+    size_t used;                /* Number of bytes in BUF. */
+    uint8_t *buf;               /* Ring buffer, one page. */
+  };
+
+static size_t ring_get (struct pipe *, uint8_t *dst, size_t size);
+static size_t ring_put (struct pipe *, const uint8_t *src, size_t size);
+
+/* Creates an empty pipe with one reading end and one writing end
+   open.  Returns a null pointer if memory is not available. */
+struct pipe *
+pipe_create (void)
+{
+  struct pipe *p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->buf = palloc_get_page (0);
+  if (p->buf == NULL)
+    {
+      free (p);
+      return NULL;
+    }
+
+  lock_init (&p->lock);
+  cond_init (&p->not_empty);
+  cond_init (&p->not_full);
+  pollq_init (&p->pollers);
+  p->readers = p->writers = 1;
+  p->head = p->used = 0;
+  return p;
+}
+
+/* Opens another end of P, a writing end if WRITER is true and a
+   reading end otherwise. */
+void
+pipe_dup (struct pipe *p, bool writer)
+{
+  lock_acquire (&p->lock);
+  if (writer)
+    p->writers++;
+  else
+    p->readers++;
+  lock_release (&p->lock);
+}
+
+/* Closes one end of P, the writing end if WRITER is true and the
+   reading end otherwise.  Frees P once its last end is closed. */
+void
+pipe_close (struct pipe *p, bool writer)
+{
+  bool dead;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      p->writers--;
+      cond_broadcast (&p->not_empty, &p->lock);
+    }
+  else
+    {
+      p->readers--;
+      cond_broadcast (&p->not_full, &p->lock);
+    }
+  pollq_wake (&p->pollers);
+  dead = p->readers == 0 && p->writers == 0;
+  lock_release (&p->lock);
+
+  if (dead)
+    {
+      palloc_free_page (p->buf);
+      free (p);
+    }
+}
+
+/* Reads up to SIZE bytes from P into user buffer UBUF.  Blocks
+   until at least one byte is available, unless NONBLOCK is true,
+   but never waits for more once it has some.  Returns the number
+   of bytes read, 0 at end of file (no data and no writers), or -1
+   if NONBLOCK is true and reading would block.  Kills the process
+   if UBUF is bad.
+
+   Waiting is done before UBUF is pinned, so that a blocked reader
+   holds no frames; another reader may empty P in between, in
+   which case we wait again. */
+int
+pipe_read (struct pipe *p, void *ubuf, unsigned size, bool nonblock)
+{
+  uint8_t *dst = ubuf;
+  unsigned total = 0;
+
+  while (total < size)
+    {
+      size_t chunk = size - total < PIPE_SIZE ? size - total : PIPE_SIZE;
+      bool would_block;
+      size_t n;
+
+      if (total == 0 && !nonblock)
+        {
+          lock_acquire (&p->lock);
+          while (p->used == 0 && p->writers > 0)
+            cond_wait (&p->not_empty, &p->lock);
+          lock_release (&p->lock);
+        }
+
+      if (!page_pin_range (dst + total, chunk, true))
+        exit (-1);
+
+      lock_acquire (&p->lock);
+      n = ring_get (p, dst + total, chunk);
+      if (n > 0)
+        {
+          cond_broadcast (&p->not_full, &p->lock);
+          pollq_wake (&p->pollers);
+        }
+      would_block = n == 0 && total == 0 && p->writers > 0;
+      lock_release (&p->lock);
+
+      page_unpin_range (dst + total, chunk);
+      if (n == 0)
+        {
+          if (would_block && !nonblock)
+            continue;
+          return would_block ? -1 : (int) total;
+        }
+      total += n;
+    }
+  return total;
+}
+
+/* Writes SIZE bytes from user buffer UBUF into P, blocking while
+   P is full, unless NONBLOCK is true, in which case only as much
+   as fits is written.  Returns the number of bytes written, or -1
+   if none could be, either because P has no reader or because
+   NONBLOCK is true and P is full.  Kills the process if UBUF is
+   bad.
+
+   As in pipe_read(), UBUF is pinned only while copying, never
+   while waiting for room. */
+int
+pipe_write (struct pipe *p, const void *ubuf, unsigned size, bool nonblock)
+{
+  const uint8_t *src = ubuf;
+  unsigned total = 0;
+
+  while (total < size)
+    {
+      size_t chunk = size - total < PIPE_SIZE ? size - total : PIPE_SIZE;
+      bool no_readers;
+      size_t put = 0;
+
+      if (!nonblock)
+        {
+          lock_acquire (&p->lock);
+          while (p->used == PIPE_SIZE && p->readers > 0)
+            cond_wait (&p->not_full, &p->lock);
+          lock_release (&p->lock);
+        }
+
+      if (!page_pin_range (src + total, chunk, false))
+        exit (-1);
+
+      lock_acquire (&p->lock);
+      no_readers = p->readers == 0;
+      if (!no_readers)
+        put = ring_put (p, src + total, chunk);
+      if (put > 0)
+        {
+          cond_broadcast (&p->not_empty, &p->lock);
+          pollq_wake (&p->pollers);
+        }
+      lock_release (&p->lock);
+
+      page_unpin_range (src + total, chunk);
+      total += put;
+      if (no_readers || (nonblock && put < chunk))
+        return total > 0 ? (int) total : -1;
+    }
+  return total;
+}
+
+/* Returns the POLL* events that are ready on one end of P, the
+   writing end if WRITER is true and the reading end otherwise.
+   If E is nonnull, first adds it to P's poll queue on behalf of
+   POLLER, so that any later change to P wakes POLLER. */
+int
+pipe_poll (struct pipe *p, bool writer,
+           struct pollq_entry *e, struct poller *poller)
+{
+  int events = 0;
+
+  lock_acquire (&p->lock);
+  if (e != NULL)
+    pollq_add (&p->pollers, e, poller);
+  if (writer)
+    {
+      if (p->readers == 0)
+        events |= POLLERR;
+      else if (p->used < PIPE_SIZE)
+        events |= POLLOUT;
+    }
+  else
+    {
+      if (p->used > 0)
+        events |= POLLIN;
+      if (p->writers == 0)
+        events |= POLLHUP;
+    }
+  lock_release (&p->lock);
+
+  return events;
+}
+
+/* Moves up to SIZE bytes out of P's ring buffer into DST.
+   Returns the number of bytes moved. */
+static size_t
+ring_get (struct pipe *p, uint8_t *dst, size_t size)
+{
+  size_t done = 0;
+
+  while (done < size && p->used > 0)
+    {
+      size_t run = PIPE_SIZE - p->head;
+      if (run > p->used)
+        run = p->used;
+      if (run > size - done)
+        run = size - done;
+
+      memcpy (dst + done, p->buf + p->head, run);
+      p->head = (p->head + run) % PIPE_SIZE;
+      p->used -= run;
+      done += run;
+    }
+  return done;
+}
+
+/* Moves up to SIZE bytes from SRC into P's ring buffer, as many
+   as fit.  Returns the number of bytes moved. */
+static size_t
+ring_put (struct pipe *p, const uint8_t *src, size_t size)
+{
+  size_t done = 0;
+
+  while (done < size && p->used < PIPE_SIZE)
+    {
+      size_t tail = (p->head + p->used) % PIPE_SIZE;
+      size_t run = PIPE_SIZE - tail;
+      if (run > PIPE_SIZE - p->used)
+        run = PIPE_SIZE - p->used;
+      if (run > size - done)
+        run = size - done;
+
+      memcpy (p->buf + tail, src + done, run);
+      p->used += run;
+      done += run;
+    }
+  return done;
+}
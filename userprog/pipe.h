@@ -0,0 +1,19 @@
+#ifndef USERPROG_PIPE_H
+#define USERPROG_PIPE_H
+
+#include <stdbool.h>
+
+struct pipe;
+struct poller;
+struct pollq_entry;
+
+struct pipe *pipe_create (void);
+void pipe_dup (struct pipe *, bool writer);
+void pipe_close (struct pipe *, bool writer);
+int pipe_read (struct pipe *, void *ubuf, unsigned size, bool nonblock);
+int pipe_write (struct pipe *, const void *ubuf, unsigned size,
+                bool nonblock);
+int pipe_poll (struct pipe *, bool writer,
+               struct pollq_entry *, struct poller *);
+
+#endif /* userprog/pipe.h */
@@ -9,9 +9,12 @@
 #include "userprog/tss.h"
 #include "userprog/process.h"
 #include "userprog/syscall.h"
+#include "userprog/elfcache.h"
+#include "userprog/fdtable.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
@@ -22,8 +25,12 @@
 #include "lib/string.h"
 #include "vm/page.h"
 
+/* Cache that child_process records are allocated from. */
+static struct obj_cache *child_cache;
+
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool inherit_fds (void);
 void push_to_stack(void **stack_ptr, void *src, int size);
 
 /* Starts a new thread running a user program loaded from
@@ -111,7 +118,7 @@ start_process (void *file_name_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  success = inherit_fds () && load (file_name, &if_.eip, &if_.esp);
 
   /* If load failed, quit. */
   palloc_free_page (file_name);
@@ -128,6 +135,20 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+/* Gives the current process a copy of its parent's file
+   descriptors, so that a shell can connect a child's standard
+   input and output to pipes or files.  The parent is blocked in
+   process_execute() until the load finishes, so its table cannot
+   change under us.  Returns false if memory runs out. */
+static bool
+inherit_fds (void) 
+{
+  struct thread *cur = thread_current ();
+  struct thread *parent = thread_get (cur->parent_tid);
+
+  return parent == NULL || fd_table_copy (&cur->fds, &parent->fds);
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -167,6 +188,9 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
+  /* Close all open files. */
+  fd_table_destroy (&cur->fds);
+
 	//printf("Clearing SPT\n");
   spt_clear (cur);
 	//printf("Finished clearing SPT\n");
@@ -196,8 +220,13 @@ process_activate (void)
 {
   struct thread *t = thread_current ();
 
-  /* Activate thread's page tables. */
-  pagedir_activate (t->pagedir);
+  /* Activate thread's page tables.  A kernel thread never touches
+     user memory, so it keeps whatever address space is loaded
+     rather than paying a TLB flush to switch to the kernel-only
+     page directory; pagedir_destroy() takes care that a borrowed
+     page directory is not freed while it is loaded. */
+  if (t->pagedir != NULL)
+    pagedir_activate (t->pagedir);
 
   /* Set thread's kernel stack for use in processing
      interrupts. */
@@ -268,6 +297,7 @@ struct Elf32_Phdr
 #define PF_R 4          /* Readable. */
 
 static bool setup_stack (void **esp, const char *args);
+static bool read_image (struct file *, struct elf_image *);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
@@ -281,16 +311,14 @@ bool
 load (const char *args, void (**eip) (void), void **esp) 
 {
   struct thread *t = thread_current();
-  struct Elf32_Ehdr ehdr;
+  struct elf_image image;
+  block_sector_t sector;
   struct file *file = NULL;
-  off_t file_ofs;
   bool success = false;
   int i;
   char *token, *args_copy, *save_ptr;
 
-  struct thread *parent = thread_get(t->parent_tid);
-  struct list_elem *e = list_back(&(parent->child_processes));
-  struct child_process *me = list_entry(e, struct child_process, elem);
+  struct child_process *me = t->child_info;
 
   args_copy = (char *)(malloc((strlen(args) + 1) * sizeof(char)));
   strlcpy(args_copy, args, strlen(args)+1);
@@ -326,7 +354,73 @@ load (const char *args, void (**eip) (void), void **esp)
       goto done; 
     }
 
+  /* Find the executable's segments, parsing its headers only if
+     they are not cached from an earlier exec. */
+  sector = inode_get_inumber (file_get_inode (file));
+  if (!elf_cache_lookup (sector, &image))
+    {
+      if (!read_image (file, &image))
+        {
+          printf ("load: %s: error loading executable\n", token);
+          goto done;
+        }
+      elf_cache_insert (sector, &image);
+    }
+
+  for (i = 0; i < image.seg_cnt; i++)
+    {
+      const struct elf_segment *seg = &image.segs[i];
+      if (!load_segment (file, seg->file_page, (void *) seg->mem_page,
+                         seg->read_bytes, seg->zero_bytes, seg->writable))
+        goto done;
+    }
+
+  /* Set up stack. */
+  if (!setup_stack (esp, args)) 
+  {
+    /* printf("error loc 9\n"); */
+    goto done;
+  }
+
+  /* Start address. */
+  *eip = image.entry;
+
+  success = true;
+
+ done: /* We arrive here whether the load is successful or not. */
+	lock_release (&file_lock);
+  if (success)
+    {
+      me->load_status = 1;
+      /* printf ("load successful\n"); */
+    }
+  else
+    {
+      me->load_status = -1;
+      /* printf ("load unsuccessful\n"); */
+    }
+  sema_up(&(me->loaded));
+
+  free (args_copy);
+  //file_close (file);
+  return success;
+}
+
+/* load() helpers. */
+
+/* Reads and verifies the ELF header and program headers of FILE
+   and stores what load() needs from them in IMAGE.  Returns
+   false if FILE is not a valid executable, or has more than
+   ELF_MAX_SEGMENTS loadable segments. */
+static bool
+read_image (struct file *file, struct elf_image *image)
+{
+  struct Elf32_Ehdr ehdr;
+  off_t file_ofs;
+  int i;
+
   /* Read and verify executable header. */
+  file_seek (file, 0);
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
       || ehdr.e_type != 2
@@ -334,11 +428,10 @@ load (const char *args, void (**eip) (void), void **esp)
       || ehdr.e_version != 1
       || ehdr.e_phentsize != sizeof (struct Elf32_Phdr)
       || ehdr.e_phnum > 1024) 
-    {
-      printf ("load: %s: error loading executable\n", token);
-      /* printf("error loc 3\n"); */
-      goto done; 
-    }
+    return false;
+
+  image->entry = (void (*) (void)) ehdr.e_entry;
+  image->seg_cnt = 0;
 
   /* Read program headers. */
   file_ofs = ehdr.e_phoff;
@@ -348,19 +441,15 @@ load (const char *args, void (**eip) (void), void **esp)
   for (i = 0; i < ehdr.e_phnum; i++) 
     {
       struct Elf32_Phdr phdr;
+      struct elf_segment *seg;
+      uint32_t page_offset;
 
       if (file_ofs < 0 || file_ofs > file_length (file))
-      {
-        /* printf("error loc 4\n"); */
-        goto done;
-      }
+        return false;
       file_seek (file, file_ofs);
 
       if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-      {
-        /* printf("error loc 5\n"); */
-        goto done;
-      }
+        return false;
       file_ofs += sizeof phdr;
       switch (phdr.p_type) 
         {
@@ -374,79 +463,37 @@ load (const char *args, void (**eip) (void), void **esp)
         case PT_DYNAMIC:
         case PT_INTERP:
         case PT_SHLIB:
-          /* printf("error loc 6\n"); */
-          goto done;
+          return false;
         case PT_LOAD:
-          if (validate_segment (&phdr, file)) 
+          if (!validate_segment (&phdr, file)
+              || image->seg_cnt == ELF_MAX_SEGMENTS)
+            return false;
+
+          seg = &image->segs[image->seg_cnt++];
+          seg->writable = (phdr.p_flags & PF_W) != 0;
+          seg->file_page = phdr.p_offset & ~PGMASK;
+          seg->mem_page = phdr.p_vaddr & ~PGMASK;
+          page_offset = phdr.p_vaddr & PGMASK;
+          if (phdr.p_filesz > 0)
             {
-              bool writable = (phdr.p_flags & PF_W) != 0;
-              uint32_t file_page = phdr.p_offset & ~PGMASK;
-              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
-              uint32_t page_offset = phdr.p_vaddr & PGMASK;
-              uint32_t read_bytes, zero_bytes;
-              if (phdr.p_filesz > 0)
-                {
-                  /* Normal segment.
-                     Read initial part from disk and zero the rest. */
-                  read_bytes = page_offset + phdr.p_filesz;
-                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
-                }
-              else 
-                {
-                  /* Entirely zero.
-                     Don't read anything from disk. */
-                  read_bytes = 0;
-                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
-                }
-              if (!load_segment (file, file_page, (void *) mem_page,
-                                 read_bytes, zero_bytes, writable))
-              {
-                /* printf("error loc 7\n"); */
-                goto done;
-              }
+              /* Normal segment.
+                 Read initial part from disk and zero the rest. */
+              seg->read_bytes = page_offset + phdr.p_filesz;
+              seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
+                                 - seg->read_bytes);
             }
           else 
-          {
-            /* printf("error loc 8\n"); */
-            goto done;
-          }
+            {
+              /* Entirely zero.
+                 Don't read anything from disk. */
+              seg->read_bytes = 0;
+              seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+            }
           break;
         }
     }
-
-  /* Set up stack. */
-  if (!setup_stack (esp, args)) 
-  {
-    /* printf("error loc 9\n"); */
-    goto done;
-  }
-
-  /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
-
-  success = true;
-
- done: /* We arrive here whether the load is successful or not. */
-	lock_release (&file_lock);
-  if (success)
-    {
-      me->load_status = 1;
-      /* printf ("load successful\n"); */
-    }
-  else
-    {
-      me->load_status = -1;
-      /* printf ("load unsuccessful\n"); */
-    }
-  sema_up(&(me->loaded));
-
-  free (args_copy);
-  //file_close (file);
-  return success;
+  return true;
 }
-
-/* load() helpers. */
 
 // static bool install_page (void *upage, void *kpage, bool writable);
 
@@ -679,10 +726,22 @@ install_page (void *upage, void *kpage, bool writable)
 }
 */
 
+/* Sets up the allocator for child_process records.  Must be
+   called before the first thread is created. */
+void
+process_init (void)
+{
+  child_cache = obj_cache_create ("child_process",
+                                  sizeof (struct child_process), NULL);
+  if (child_cache == NULL)
+    PANIC ("could not create child_process cache");
+  elf_cache_init ();
+}
+
 struct child_process *
 child_process_init (pid_t pid)
 {
-  struct child_process *new_child = (struct child_process *) (malloc (sizeof (struct child_process)));
+  struct child_process *new_child = obj_cache_alloc (child_cache);
   new_child->pid = pid;
   new_child->exit_status = 0;
   new_child->load_status = 0;
@@ -695,9 +754,13 @@ child_process_init (pid_t pid)
 void 
 child_process_free (struct child_process *cp)
 {
-  free (cp);
+  obj_cache_free (child_cache, cp);
 }
 
+/* Returns PARENT's record for its child CHILD_PID, or a null
+   pointer if CHILD_PID is not a child of PARENT.  Only PARENT's
+   own children are searched; a child finds its own record
+   through its child_info member instead. */
 struct child_process *
 child_process_get (struct thread *parent, pid_t child_pid)
 {
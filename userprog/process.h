@@ -4,6 +4,8 @@
 #include "threads/thread.h"
 #include "threads/synch.h"
 
+struct file;
+
 typedef int pid_t;
 
 struct child_process
@@ -19,6 +21,7 @@ struct child_process
     struct list_elem elem;
   };
 
+void process_init (void);
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
 void process_exit (void);
@@ -2,6 +2,7 @@
 #include <syscall-nr.h>
 #include <stdbool.h>
 #include <string.h>
+#include <tsc.h>
 #include "devices/shutdown.h"
 #include "userprog/syscall.h"
 #include "userprog/process.h"
@@ -15,131 +16,45 @@
 #include "threads/synch.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
+#include "threads/palloc.h"
+#include "threads/pollq.h"
+#include "threads/stats.h"
+#include "userprog/fdtable.h"
+#include "userprog/pipe.h"
+#include "userprog/systrace.h"
+#include "userprog/uaccess.h"
 
 #include "vm/page.h"
 #include "vm/frame.h"
 
-#define PTR_WRITE 0
-#define PTR_READ 1
+/* Most bytes of a read() or write() buffer pinned at once. */
+#define IO_CHUNK_SIZE (16 * PGSIZE)
 
 static void syscall_handler (struct intr_frame *);
+static uint32_t syscall_dispatch (int sys_no, const uint32_t *args);
+static uint32_t timed_dispatch (int sys_no, const uint32_t *args);
+static int batch (struct syscall_record *recs, unsigned cnt);
+static int stats (char *buf, unsigned size);
+static int trace (struct syscall_event *events, unsigned max);
+static int console_read (uint8_t *buffer, unsigned size, bool nonblock);
+static int fd_poll (int fd, struct pollq_entry *, struct poller *);
 int get_arg (void *esp, uint32_t *args, int num_args);
 
 /* File system private functions. */
 struct file* fd_to_file(struct thread* t, int fd);
-bool ptr_valid(void *esp, const void* ptr, int len, bool is_read);
 bool is_open(struct thread* t, int fd);
 
 /* Checks if a threads's given file descriptor is valid/open.
  * Assumes that this is for files and not STDIN/STDOUT. */
 bool is_open(struct thread* t, int fd)
 {
-  bool isOpen;
-
-  /* Cannot be STDIN/STDOUT. */
-  if (fd == 0 || fd == 1)
-    {
-      isOpen = false;
-    }
-
-  else 
-    {
-      /* Range check. */
-      if (fd >= t->open_files->size || fd < 0)
-        {
-          isOpen = false;
-        }
-
-      /* Range valid, check fd. */
-      else 
-        {
-          isOpen = t->open_files->isOpen[fd];
-        }
-    }
-
- return isOpen; 
+  return fd_file (&t->fds, fd) != NULL;
 }
 
 /* File system common function converting a file descriptor (fd) to a file pointer.
  * Returns a NULL if fd is STDIN, STDIN, or a not open file. */
 struct file* fd_to_file(struct thread* t, int fd){
-  struct file* f;    
-
-  /* Check validity of fd. */
-  if (!is_open(t, fd))
-    {
-      f = NULL;
-    }
-  else 
-    {
-      f = t->open_files->files[fd];
-    }
-
-  return f;
-}
-
-bool 
-ptr_valid(void *esp, const void* ptr, int len, bool is_read)
-{
-/* 
- * If operation is a read, then perform dummy reads on each page
- * that starts from (ptr) to (ptr+len). This will cause a page fault exception
- * and the page fault handler can take care of proper allocation.
-
- * If operation is a write, check first if SPTE is allocated and load 
- * the frames in. If no SPTE is found, check to see if the entire
- * memory locations from (ptr) to (ptr+len) is within the stack.
- * If it is, grow the stack accordingly.
- */
-  if (ptr + len < PHYS_BASE
-   && ptr > USER_BOTTOM)
-    {
-      const void* page_bottom;
-      /* While loop iterates through all the pages that (ptr) to (ptr+len) occupy. */
-      while (len >= 0) 
-       {
-         if (is_read)
-           {
-             /* 
-              * This dummy read causes a page fault exception and 
-              * we let the handler take care of lazy loading, if needed.
-              */
-             volatile int dummy = * (int*)(ptr);
-           }
-
-         else 
-           {
-             struct sup_pte *spte = get_spte((uint8_t *) ptr);
-             if (spte)
-               {
-                 if (!spte->writable)
-                   {
-                     exit(-1);
-                   }
-
-                 load_spte(spte);
-               }
-
-             else if (ptr >= esp)
-               {
-                 alloc_blank_spte ((uint8_t *) ptr);
-               }
-
-             else
-               {
-                 exit (-1);
-               }
-           }
-
-         page_bottom = pg_round_up(ptr) + 1;
-         len -= (page_bottom - ptr);
-         ptr = page_bottom;
-       }
-
-      return true;
-    }
-
-  return false;
+  return fd_file (&t->fds, fd);
 }
 
 void
@@ -147,293 +62,256 @@ syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
   lock_init(&file_lock);
+  lock_set_name (&file_lock, "file");
 }
 
+/* Copies NUM_ARGS system call arguments from the user stack at
+   ESP into ARGS.  Returns -1 if they cannot be read. */
 int
 get_arg (void *esp, uint32_t *args, int num_args)
 {
-  if(!ptr_valid(esp, esp, num_args, PTR_READ)){return -1;}
   uint32_t *sp = (uint32_t *) esp;
-  int i;
-  for (i = 0; i < num_args; i++) 
+  return copy_from_user (args, sp + 1, num_args * sizeof *args) ? 1 : -1;
+}
+
+/* Number of arguments taken by each system call, or -1 if the
+   call is not implemented. */
+static const int syscall_arg_cnt[] =
   {
-    sp += 1;
-    if (is_user_vaddr ((const void *) sp))
-      {
-        args[i] = *sp;
-      }
-    else
-      {
-        return -1;
-      }
-  }
-  return 1;
+    [SYS_HALT] = 0,
+    [SYS_EXIT] = 1,
+    [SYS_EXEC] = 1,
+    [SYS_WAIT] = 1,
+    [SYS_CREATE] = 2,
+    [SYS_REMOVE] = 1,
+    [SYS_OPEN] = 1,
+    [SYS_FILESIZE] = 1,
+    [SYS_READ] = 3,
+    [SYS_WRITE] = 3,
+    [SYS_SEEK] = 2,
+    [SYS_TELL] = 1,
+    [SYS_CLOSE] = 1,
+    [SYS_MMAP] = -1,
+    [SYS_MUNMAP] = -1,
+    [SYS_CHDIR] = -1,
+    [SYS_MKDIR] = -1,
+    [SYS_READDIR] = -1,
+    [SYS_ISDIR] = -1,
+    [SYS_INUMBER] = -1,
+    [SYS_BATCH] = 2,
+    [SYS_PIPE] = 1,
+    [SYS_POLL] = 3,
+    [SYS_FCNTL] = 3,
+    [SYS_DUP] = 1,
+    [SYS_DUP2] = 2,
+    [SYS_STATS] = 2,
+    [SYS_TRACE] = 2,
+  };
+
+/* Returns true if SYS_NO names an implemented system call. */
+static bool
+syscall_known (int sys_no)
+{
+  return (sys_no >= 0
+          && sys_no < (int) (sizeof syscall_arg_cnt / sizeof *syscall_arg_cnt)
+          && syscall_arg_cnt[sys_no] >= 0);
 }
 
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+syscall_handler (struct intr_frame *f) 
 {
-  /* Validate stack pointer. */
-  if(!ptr_valid(f->esp, f->esp, 0, PTR_READ))
+  int sys_no;
+  uint32_t args[3] = {0, 0, 0}; /* max args = 3 */
+
+  if (!copy_from_user (&sys_no, f->esp, sizeof sys_no))
     {
       exit(-1);
     }
 
-  int sys_no = *((int *)f->esp);
-  uint32_t args[3]; /* max args = 3 */
+  if (!syscall_known (sys_no))
+    {
+      f->eax = -1;
+      thread_exit();
+    }
+
+  if (get_arg(f->esp, args, syscall_arg_cnt[sys_no]) < 0)
+    {
+      exit (-1);
+    }
+
+  stat_syscall (sys_no);
+  f->eax = timed_dispatch (sys_no, args);
+}
+
+/* Copies the user string argument ARG into a new page and returns
+   it, or returns a null pointer if no page is available.  Kills
+   the process if the string cannot be read.  The caller must free
+   the page. */
+static char *
+string_arg (uint32_t arg)
+{
+  char *str = palloc_get_page (0);
+  if (str != NULL && !copy_string_from_user (str, (const char *) arg, PGSIZE))
+    {
+      palloc_free_page (str);
+      exit (-1);
+    }
+  return str;
+}
+
+/* Carries out system call SYS_NO, which must be implemented, with
+   arguments ARGS already fetched from the user stack.  Returns
+   the value to hand back to the caller. */
+static uint32_t
+syscall_dispatch (int sys_no, const uint32_t *args)
+{
+  char *str;
+  uint32_t result;
 
   switch (sys_no) 
     {
       case SYS_HALT:                   /* Halt the operating system. */
-        {
-          halt();
-          break;
-        }
+        halt();
+        NOT_REACHED ();
 
       case SYS_EXIT:                   /* Terminate this process. */
-        {
-          if (get_arg(f->esp, args, 1) > 0)
-            {
-              exit (args[0]);
-            }
-          else
-            {
-              f->eax = -1;
-              exit (-1);
-            }
-          break;
-        }
+        exit (args[0]);
+        NOT_REACHED ();
 
       case SYS_EXEC:                   /* Start another process. */
-        {
-          if (get_arg(f->esp, args, 1) > 0)
-            {
-              const char *cmd = (const char *) (args[0]);
-              f->eax = exec(cmd);
-            }
-          else
-            {
-              f->eax = -1;
-            }
-          break;
-        }
+        str = string_arg (args[0]);
+        result = str != NULL ? exec(str) : -1;
+        palloc_free_page (str);
+        return result;
 
       case SYS_WAIT:                   /* Wait for a child process to die. */
-        {
-          if (get_arg(f->esp, args, 1) > 0)
-            {
-              f->eax = wait(args[0]);
-            }
-          else
-            {
-              f->eax = -1;
-            }
-          break;
-        }
+        return wait(args[0]);
 
       case SYS_CREATE:                 /* Create a file. */
-        {
-          if (get_arg(f->esp, args, 2) > 0)
-           {
-             unsigned size = (unsigned) args[1];
-             const char* v_file = (const char*) args[0];
-             if (v_file == NULL)
-               {
-                 exit (-1);
-               }
-          
-             if (ptr_valid(f->esp, v_file, strlen(v_file), PTR_READ))
-               {
-                 f->eax = create(v_file, size);                 
-               }
-             else 
-               {
-                 f->eip = (void*) f->eax;
-                 f->eax = -1;
-                 exit(-1);
-               }
-            }     
-          else 
-            {
-              f->eax = -1;
-            }
-          break;
-        }
+        str = string_arg (args[0]);
+        result = str != NULL && create(str, (unsigned) args[1]);
+        palloc_free_page (str);
+        return result;
         
       case SYS_REMOVE:                 /* Delete a file. */
-        {
-          if (get_arg(f->esp, args, 1) > 0)
-            {
-              const char* v_file = (const char*) args[0];
-              if (v_file == NULL)
-                {
-                  exit (-1);
-								}
-              if (ptr_valid(f->esp, v_file, strlen(v_file), PTR_READ))
-                {
-                  f->eax = remove(v_file);
-                }
-              else 
-                {
-                  f->eip = (void*) f->eax;
-                  f->eax = -1;
-                }
-            }
-
-          else  
-            {
-              f->eax = -1;
-            }
-          break;
-        }
+        str = string_arg (args[0]);
+        result = str != NULL && remove(str);
+        palloc_free_page (str);
+        return result;
 
       case SYS_OPEN:                   /* Open a file. */
-        {
-          if (get_arg(f->esp, args, 1) > 0)
-            {
-              const char* v_file = (const char*) args[0];
-              if (v_file == NULL)
-                {
-                  exit (-1);
-                }
-              if (ptr_valid(f->esp, v_file, strlen(v_file), PTR_READ))
-                {
-                  f->eax = open(v_file);
-                }
-              else 
-                {
-                  f->eip = (void*) f->eax;
-                  f->eax = -1;
-                  exit(-1);
-                }
-            }
-          else 
-            {
-              f->eax = -1;
-            }
-          break;
-        }
+        str = string_arg (args[0]);
+        result = str != NULL ? open(str) : -1;
+        palloc_free_page (str);
+        return result;
 
       case SYS_FILESIZE:               /* Obtain a file's size. */
-        {
-          if (get_arg(f->esp, args, 1) > 0)
-            {
-              int fd = (int) args[0];
-              f->eax = filesize(fd);
-            }
-          else 
-            {
-              f->eax = -1;
-            }
-          break;
-        }
+        return filesize((int) args[0]);
 
       case SYS_READ:                   /* Read from a file. */
-        {
-          if (get_arg(f->esp, args, 3) > 0)
-            {
-              int fd = (int) args[0];
-              void* v_buffer = (void*) args[1];
-              unsigned size = (unsigned) args[2];
-              if (ptr_valid(f->esp, v_buffer, size, PTR_WRITE))
-                {
-								  struct thread *t = thread_current(); 
-									if(!pagedir_is_writable(t->pagedir, v_buffer))
-										{
-											f->eax = -1;
-											exit(-1);
-										} 
-										
-                  f->eax = read(fd, v_buffer, size);
-                }
-              else
-                {
-                  f->eip = (void*) f->eax;
-                  f->eax = -1;
-                  exit (-1);
-                }
-            }
-          else 
-            {
-              f->eax = -1;
-            }
-          break;
-        }
+        return read((int) args[0], (void *) args[1], (unsigned) args[2]);
 
       case SYS_WRITE:                  /* Write to a file. */
-        { 
-          if (get_arg(f->esp, args, 3) > 0)
-            {
-              int fd = (int) args[0];
-              const void* v_buffer = (void*) args[1];
-              unsigned size = (unsigned) args[2];
-              if (ptr_valid(f->esp, v_buffer, size, PTR_READ))
-                {
-                  f->eax = write(fd, v_buffer, size);
-                }
-              else 
-                {
-                  f->eip = (void*) f->eax;
-                  f->eax = -1;
-                  exit(-1);
-                }
-            }
-          else 
-            {
-                f->eax = -1;
-            }
-          break;
-        }
+        return write((int) args[0], (const void *) args[1], (unsigned) args[2]);
 
       case SYS_SEEK:                   /* Change position in a file. */
-        {
-          if (get_arg(f->esp, args, 2) > 0)
-            {
-              int fd = (int) args[0];
-              unsigned pos = (unsigned) args[1];
-              seek(fd, pos);
-            }
-          else 
-            {
-                f->eax = -1;
-            }
-          break;
-        }
+        seek((int) args[0], (unsigned) args[1]);
+        return 0;
 
       case SYS_TELL:                   /* Report current position in a file. */
+        return tell((int) args[0]);
+
+      case SYS_CLOSE:                  /* Close a file. */
+        close((int) args[0]);
+        return 0;
+
+      case SYS_BATCH:                  /* Run several system calls. */
+        return batch((struct syscall_record *) args[0], (unsigned) args[1]);
+
+      case SYS_PIPE:                   /* Create a pipe. */
+        return pipe((int *) args[0]);
+
+      case SYS_POLL:                   /* Wait for fds to be ready. */
+        return poll((struct pollfd *) args[0], (unsigned) args[1],
+                    (int) args[2]);
+
+      case SYS_FCNTL:                  /* Get or set fd flags. */
+        return fcntl((int) args[0], (int) args[1], (int) args[2]);
+
+      case SYS_DUP:                    /* Duplicate an fd. */
+        return dup((int) args[0]);
+
+      case SYS_DUP2:                   /* Duplicate onto a given fd. */
+        return dup2((int) args[0], (int) args[1]);
+
+      case SYS_STATS:                  /* Read performance counters. */
+        return stats((char *) args[0], (unsigned) args[1]);
+
+      case SYS_TRACE:                  /* Drain the system call trace. */
+        return trace((struct syscall_event *) args[0], (unsigned) args[1]);
+      
+      default:
+        NOT_REACHED ();
+    }
+}
+
+/* Carries out system call SYS_NO like syscall_dispatch(), adding
+   the cycles it takes to its latency histogram and, unless it is
+   SYS_TRACE itself, recording it in the system call trace. */
+static uint32_t
+timed_dispatch (int sys_no, const uint32_t *args)
+{
+  uint64_t start = rdtsc ();
+  uint32_t result = syscall_dispatch (sys_no, args);
+  uint64_t cycles = rdtsc () - start;
+
+  stat_syscall_time (sys_no, cycles);
+  if (sys_no != SYS_TRACE)
+    {
+      systrace_record (sys_no, args, result, start, cycles);
+    }
+  return result;
+}
+
+/* Runs the CNT system calls described by the user array RECS in
+   order, storing each call's return value in its record, so that
+   a process can make many small calls for the cost of one trap.
+   A record naming an unknown call, or SYS_BATCH itself, gets -1.
+   Returns the number of records run. */
+static int
+batch (struct syscall_record *recs, unsigned cnt)
+{
+  unsigned i;
+
+  if (cnt > SYSCALL_BATCH_MAX)
+    {
+      exit (-1);
+    }
+
+  for (i = 0; i < cnt; i++)
+    {
+      struct syscall_record r;
+      if (!copy_from_user (&r, &recs[i], sizeof r))
         {
-          if (get_arg(f->esp, args, 1) > 0)
-            {
-              int fd = (int) args[0];
-              f->eax = tell(fd);
-            }
-          else 
-            {
-              f->eax = -1;
-            }
-          break;
+          exit (-1);
         }
 
-      case SYS_CLOSE:                  /* Close a file. */
+      if (!syscall_known (r.nr) || r.nr == SYS_BATCH)
         {
-          if (get_arg(f->esp, args, 2) > 0)
-            {
-              int fd = (int) args[0];
-              close(fd);
-            }
-          else 
-            {
-                f->eax = -1;
-            }
-          break;
+          r.result = -1;
         }
-      
-      default:
+      else
+        {
+          stat_syscall (r.nr);
+          r.result = timed_dispatch (r.nr, r.args);
+        }
+
+      if (!copy_to_user (&recs[i].result, &r.result, sizeof r.result))
         {
-          f->eax = -1;
-          thread_exit();
+          exit (-1);
         }
     }
+  return cnt;
 }
 
 
@@ -459,28 +337,14 @@ exit (int status)
   struct thread *parent = thread_get (curr->parent_tid);
   if (parent)
     {
-      struct child_process *cp_me = child_process_get (parent, curr->tid);
+      struct child_process *cp_me = curr->child_info;
       cp_me->exit_status = status;
       sema_up(&(cp_me->exited));
     }
 
   printf ("%s: exit(%d)\n", curr->name, status);
 
-  int i;
-  for (i = 0; i < curr->open_files->size; i++)
-    {
-      if (curr->open_files->isOpen)
-        {
-          lock_acquire(&file_lock);
-          file_close (curr->open_files->files[i]);
-          lock_release(&file_lock);
-        }
-    }
-
-  free (curr->open_files->files);
-  free (curr->open_files->isOpen);
-  free (curr->open_files);
-
+  /* Open files are closed by process_exit(). */
   thread_exit();
 }
 
@@ -582,7 +446,7 @@ open (const char *file)
    * which are valid as system call arguments only as explicitly described below.
    *
    * Each process has an independent set of file descriptors.
-   * File descriptors are not inherited by child processes.
+   * File descriptors are inherited by child processes started with exec.
    *
    * When a single file is opened more than once, whether by a single process or different processes, each open returns a new file descriptor.
    * Different file descriptors for a single file are closed independently in separate calls to close and they do not share a file position.
@@ -603,39 +467,15 @@ open (const char *file)
     {
       /* File opened, add to thread's open files. */
       struct thread* t = thread_current();
-      // printf("open files: %d\n", t->open_files->size);
-
-      /* Check for an open fd space in current thread's file list. */
-      /* Could also be made easier if there was a variable keeping track
-       * of how many files were open for the thread. */
-      int i;
-      bool foundHole = false;
-      for (i = 0; i < t->open_files->size; i++)
-        {
-          if (!t->open_files->isOpen[i])
-            {
-              /* Open space found. Add here. */
-              foundHole = true;
-              fd = i;
-              break;
-            }
-        }
-
-      /* No holes avaliable in open file list. Append to file list. */
-      if (!foundHole)
+      struct fd_entry e = { .type = FD_FILE, .file = f };
+      fd = fd_alloc (&t->fds, &e);
+      if (fd < 0)
         {
-          /* Allocate more memory for the file list. */
-          t->open_files->size++;
-          t->open_files->files = (struct file**) 
-              realloc(t->open_files->files, sizeof(struct file*) * t->open_files->size);
-          t->open_files->isOpen = (bool*) 
-              realloc(t->open_files->isOpen, sizeof(bool) * t->open_files->size);
-
-          fd = t->open_files->size - 1;
+          lock_acquire(&file_lock);
+          file_close(f);
+          lock_release(&file_lock);
+          return -1;
         }
-
-      t->open_files->files[fd] = f;
-      t->open_files->isOpen[fd] = true;
       
       /* Determine if this is an ELF file. If so, deny write access. */
       lock_acquire(&file_lock);
@@ -685,44 +525,59 @@ read (int fd, void *buffer, unsigned size)
    *
    * Fd 0 reads from the keyboard using input_getc(). 
    */
-  /* Return value. */
-  int bytes_read;
-  /* Cannot read from STDOUT. */
-  if (fd == 1) 
+  struct fd_entry *e = fd_lookup (&thread_current()->fds, fd);
+  struct file *f;
+  int bytes_read = 0;
+
+  if (e == NULL)
     {
-      bytes_read = -1;
+      return -1;
     }
 
-  /* Handle STDIN. */
-  else if (fd == 0)
+  switch (e->type)
     {
-      /* Read in 'size' number of characters form the console. */
-      char* buf = (char*) buffer;
-      unsigned i;
-      for (i = 0; i < size; i++)
-        {
-          buf[i] = input_getc();
-        }
-      /* Null termination. */
-      buf[size] = 0;
-      bytes_read = size;
-   }
+      case FD_CONSOLE_IN:
+        return console_read (buffer, size, e->flags & O_NONBLOCK);
 
-  else
+      case FD_PIPE_READ:
+        return pipe_read (e->pipe, buffer, size, e->flags & O_NONBLOCK);
+
+      case FD_FILE:
+        f = e->file;
+        break;
+
+      default:
+        return -1;
+    }
+
+  /* Data goes straight into the user buffer, a chunk at a time.
+     Each chunk is pinned first, so no page fault can happen while
+     file_lock is held. */
+  while (size > 0)
     {
-      /* Read from file. */
-      struct file* f = fd_to_file(thread_current(), fd);
-      if (f == NULL)
+      uint8_t *chunk_buf = (uint8_t *) buffer + bytes_read;
+      unsigned chunk = size < IO_CHUNK_SIZE ? size : IO_CHUNK_SIZE;
+      unsigned got;
+
+      if (!page_pin_range (chunk_buf, chunk, true))
         {
-          bytes_read = -1;
+          exit (-1);
         }
-      else
+
+      lock_acquire(&file_lock);
+      got = file_read(f, chunk_buf, chunk);
+      lock_release(&file_lock);
+
+      page_unpin_range (chunk_buf, chunk);
+
+      bytes_read += got;
+      size -= got;
+      if (got < chunk)
         {
-          lock_acquire(&file_lock);
-          bytes_read = (int) file_read(f, buffer, size);
-          lock_release(&file_lock);
+          break;
         }
     }
+
   return bytes_read;
 }
 
@@ -742,36 +597,72 @@ write (int fd, const void *buffer, unsigned size)
    * Otherwise, lines of text output by different processes may end up interleaved on the console,
    * confusing both human readers and our grading scripts.
    */
-  int bytes_written;
+  struct fd_entry *e = fd_lookup (&thread_current()->fds, fd);
+  struct file *f;
+  int bytes_written = 0;
 
-  /* Cannot write to STDIN. */
-  if (fd == 0)
+  if (e == NULL)
     {
-      bytes_written = -1;
+      return -1;
     }
 
-  /* Handle STDOUT. */
-  else if (fd == 1)
+  switch (e->type)
     {
-      putbuf(buffer, size);
-      bytes_written = size;
-    }    
+      case FD_CONSOLE_OUT:
+        f = NULL;
+        break;
 
-  /* Write to file. */
-  else 
+      case FD_PIPE_WRITE:
+        return pipe_write (e->pipe, buffer, size, e->flags & O_NONBLOCK);
+
+      case FD_FILE:
+        f = e->file;
+        break;
+
+      default:
+        return -1;
+    }
+
+  /* As in read(), the user buffer is used in place, pinned a chunk
+     at a time. Console output goes out one chunk per putbuf(),
+     well past the few hundred bytes that must not be interleaved
+     with other processes' output. */
+  while (size > 0)
     {
-      struct file* f = fd_to_file(thread_current(), fd);
+      const uint8_t *chunk_buf = (const uint8_t *) buffer + bytes_written;
+      unsigned chunk = size < IO_CHUNK_SIZE ? size : IO_CHUNK_SIZE;
+      unsigned put;
+
+      if (!page_pin_range (chunk_buf, chunk, false))
+        {
+          exit (-1);
+        }
+
+      /* Handle STDOUT. */
       if (f == NULL)
         {
-          bytes_written = -1;
+          putbuf((const char *) chunk_buf, chunk);
+          put = chunk;
         }
-      else 
+
+      /* Write to file. */
+      else
         {
           lock_acquire(&file_lock);
-          bytes_written = (int) file_write(f, buffer, size);
+          put = file_write(f, chunk_buf, chunk);
           lock_release(&file_lock);
         }
-     }
+
+      page_unpin_range (chunk_buf, chunk);
+
+      bytes_written += put;
+      size -= put;
+      if (put < chunk)
+        {
+          break;
+        }
+    }
+
   return bytes_written;
 }
 
@@ -825,15 +716,334 @@ close (int fd)
    * Closes file descriptor fd.
    * Exiting or terminating a process implicitly closes all its open file descriptors, as if by calling this function for each one. 
    */
-  struct thread* t = thread_current();
-  /* Check fd validity. */
-  if (is_open(t, fd))
+  fd_release (&thread_current()->fds, fd);
+}
+
+/* Reads up to SIZE bytes of console input into user BUFFER.
+   Blocks for the first byte unless NONBLOCK is true, then takes
+   only what has already been typed, so that a large buffer does
+   not wait for the user to fill it.  Returns the number of bytes
+   read, or -1 if NONBLOCK is true and no input is waiting.
+
+   Input is gathered into a small kernel buffer and then copied
+   out, so that no user page is pinned while waiting for the user
+   to type. */
+static int
+console_read (uint8_t *buffer, unsigned size, bool nonblock)
+{
+  uint8_t kbuf[64];
+  unsigned got = 0;
+  unsigned n = 0;
+
+  if (size > IO_CHUNK_SIZE)
     {
-      lock_acquire(&file_lock);
-      file_close(fd_to_file(t, fd));
-      lock_release(&file_lock);
-      
-      t->open_files->files[fd] = NULL;
-      t->open_files->isOpen[fd] = false; 
+      size = IO_CHUNK_SIZE;
+    }
+  if (size == 0)
+    {
+      return 0;
+    }
+
+  if (!nonblock)
+    {
+      kbuf[n++] = input_getc();
+    }
+  for (;;)
+    {
+      while (got + n < size && n < sizeof kbuf && input_try_getc (&kbuf[n]))
+        {
+          n++;
+        }
+      if (n == 0)
+        {
+          break;
+        }
+      if (!copy_to_user (buffer + got, kbuf, n))
+        {
+          exit (-1);
+        }
+      got += n;
+      n = 0;
+    }
+
+  return got > 0 ? (int) got : -1;
+}
+
+int
+pipe (int *fds)
+{
+  /*
+   * Creates a pipe and stores file descriptors for its reading end in fds[0] and its writing end in fds[1].
+   * Returns 0 if successful, -1 otherwise.
+   */
+  struct fd_table *t = &thread_current()->fds;
+  struct fd_entry e;
+  int kfds[2];
+  struct pipe *p = pipe_create ();
+
+  if (p == NULL)
+    {
+      return -1;
+    }
+
+  memset (&e, 0, sizeof e);
+  e.pipe = p;
+  e.type = FD_PIPE_READ;
+  kfds[0] = fd_alloc (t, &e);
+  if (kfds[0] < 0)
+    {
+      pipe_close (p, false);
+      pipe_close (p, true);
+      return -1;
+    }
+  e.type = FD_PIPE_WRITE;
+  kfds[1] = fd_alloc (t, &e);
+  if (kfds[1] < 0)
+    {
+      fd_release (t, kfds[0]);
+      pipe_close (p, true);
+      return -1;
+    }
+
+  if (!copy_to_user (fds, kfds, sizeof kfds))
+    {
+      exit (-1);
+    }
+  return 0;
+}
+
+int
+poll (struct pollfd *ufds, unsigned nfds, int timeout)
+{
+  /*
+   * Waits until one of the nfds file descriptors in ufds is ready for an event given in its events member,
+   * then stores the events that are ready in each revents member and returns the number of fds with any.
+   * Negative fds are ignored.
+   * A timeout of 0 returns at once and a negative timeout waits indefinitely.
+   * Other timeouts are not supported and return -1.
+   */
+  struct pollfd *fds;
+  struct pollq_entry *entries;
+  struct poller poller;
+  unsigned i;
+  int ready;
+
+  if (nfds > POLL_MAX || timeout > 0)
+    {
+      return -1;
+    }
+
+  fds = malloc (nfds * sizeof *fds);
+  entries = malloc (nfds * sizeof *entries);
+  if (nfds > 0 && (fds == NULL || entries == NULL))
+    {
+      free (fds);
+      free (entries);
+      return -1;
+    }
+  if (!copy_from_user (fds, ufds, nfds * sizeof *fds))
+    {
+      free (fds);
+      free (entries);
+      exit (-1);
+    }
+  for (i = 0; i < nfds; i++)
+    {
+      pollq_entry_init (&entries[i]);
+    }
+
+  /* Each pass puts an entry on the poll queue of every fd before
+     checking it, so an fd that becomes ready after its check still
+     wakes us. */
+  for (;;)
+    {
+      poller_init (&poller);
+      ready = 0;
+      for (i = 0; i < nfds; i++)
+        {
+          int events = fd_poll (fds[i].fd, timeout != 0 ? &entries[i] : NULL,
+                                &poller);
+          fds[i].revents = events & (fds[i].events
+                                     | POLLERR | POLLHUP | POLLNVAL);
+          if (fds[i].revents != 0)
+            {
+              ready++;
+            }
+        }
+      if (ready > 0 || timeout == 0)
+        {
+          break;
+        }
+
+      poller_sleep (&poller);
+      for (i = 0; i < nfds; i++)
+        {
+          pollq_remove (&entries[i]);
+        }
+    }
+  for (i = 0; i < nfds; i++)
+    {
+      pollq_remove (&entries[i]);
+    }
+  free (entries);
+
+  if (!copy_to_user (ufds, fds, nfds * sizeof *fds))
+    {
+      free (fds);
+      exit (-1);
+    }
+  free (fds);
+  return ready;
+}
+
+int
+fcntl (int fd, int cmd, int arg)
+{
+  /*
+   * With cmd F_GETFL, returns the flags of file descriptor fd.
+   * With cmd F_SETFL, sets them to arg, of which only O_NONBLOCK and O_CLOEXEC are kept, and returns 0.
+   * Returns -1 if fd is not open or cmd is unknown.
+   */
+  struct fd_entry *e = fd_lookup (&thread_current()->fds, fd);
+
+  if (e == NULL)
+    {
+      return -1;
+    }
+
+  switch (cmd)
+    {
+      case F_GETFL:
+        return e->flags;
+
+      case F_SETFL:
+        e->flags = arg & (O_NONBLOCK | O_CLOEXEC);
+        return 0;
+
+      default:
+        return -1;
+    }
+}
+
+int
+dup (int fd)
+{
+  /*
+   * Returns the lowest unused file descriptor, made to refer to what fd refers to, or -1 if fd is not open.
+   * A duplicated file has its own position.
+   */
+  return fd_dup (&thread_current()->fds, fd, -1);
+}
+
+int
+dup2 (int fd, int newfd)
+{
+  /*
+   * Makes newfd refer to what fd refers to, closing newfd first if it is open, and returns newfd.
+   * Returns -1 if fd is not open or newfd is negative or at least FD_MAX.
+   */
+  if (newfd < 0 || newfd >= FD_MAX)
+    {
+      return -1;
+    }
+  return fd_dup (&thread_current()->fds, fd, newfd);
+}
+
+/* Formats the kernel's performance counters as text, one "NAME
+   VALUE" line each, into the user buffer BUF of SIZE bytes,
+   truncating and null-terminating like snprintf().  Returns the
+   number of bytes stored, not counting the null terminator, or -1
+   if no memory is available. */
+static int
+stats (char *buf, unsigned size)
+{
+  char *page;
+  size_t len;
+
+  if (size == 0)
+    {
+      return 0;
+    }
+
+  page = palloc_get_page (0);
+  if (page == NULL)
+    {
+      return -1;
+    }
+  len = stats_format (page, size < PGSIZE ? size : PGSIZE);
+  if (!copy_to_user (buf, page, len + 1))
+    {
+      palloc_free_page (page);
+      exit (-1);
+    }
+  palloc_free_page (page);
+  return len;
+}
+
+/* Moves up to MAX of the oldest unread events from the system
+   call trace into the user array EVENTS.  Returns the number
+   moved, which is at most one page's worth, so the caller should
+   call again until it gets 0, or -1 if no memory is available. */
+static int
+trace (struct syscall_event *events, unsigned max)
+{
+  struct syscall_event *page;
+  size_t cnt;
+
+  page = palloc_get_page (0);
+  if (page == NULL)
+    {
+      return -1;
+    }
+  cnt = systrace_drain (page, max < PGSIZE / sizeof *page
+                              ? max : PGSIZE / sizeof *page);
+  if (!copy_to_user (events, page, cnt * sizeof *page))
+    {
+      palloc_free_page (page);
+      exit (-1);
+    }
+  palloc_free_page (page);
+  return cnt;
+}
+
+/* Returns the POLL* events ready on FD, or POLLNVAL if FD is not
+   open, or 0 if FD is negative.  If E is nonnull, first adds it to
+   the poll queue of whatever FD refers to, if that can ever become
+   ready, on behalf of POLLER. */
+static int
+fd_poll (int fd, struct pollq_entry *e, struct poller *poller)
+{
+  struct fd_entry *fde;
+
+  if (fd < 0)
+    {
+      return 0;
+    }
+
+  fde = fd_lookup (&thread_current()->fds, fd);
+  if (fde == NULL)
+    {
+      return POLLNVAL;
+    }
+
+  switch (fde->type)
+    {
+      case FD_CONSOLE_IN:
+        return input_poll (e, poller) ? POLLIN : 0;
+
+      case FD_CONSOLE_OUT:
+        return POLLOUT;
+
+      case FD_FILE:
+        return POLLIN | POLLOUT;
+
+      case FD_PIPE_READ:
+        return pipe_poll (fde->pipe, false, e, poller);
+
+      case FD_PIPE_WRITE:
+        return pipe_poll (fde->pipe, true, e, poller);
+
+      default:
+        return POLLNVAL;
     }
 }
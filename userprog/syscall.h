@@ -91,7 +91,7 @@ bool remove (const char *file);
  * which are valid as system call arguments only as explicitly described below.
  *
  * Each process has an independent set of file descriptors.
- * File descriptors are not inherited by child processes.
+ * File descriptors are inherited by child processes started with exec.
  *
  * When a single file is opened more than once, whether by a single process or different processes, each open returns a new file descriptor.
  * Different file descriptors for a single file are closed independently in separate calls to close and they do not share a file position.
@@ -150,5 +150,36 @@ unsigned tell (int fd);
  */
 void close (int fd);
 
+/*
+ * Creates a pipe and stores file descriptors for its reading end in fds[0] and its writing end in fds[1].
+ * Returns 0 if successful, -1 otherwise.
+ */
+int pipe (int *fds);
+
+/*
+ * Waits until one of the nfds file descriptors in fds is ready for an event given in its events member,
+ * then stores the events that are ready in each revents member and returns the number of fds with any.
+ * A timeout of 0 returns at once and a negative timeout waits indefinitely.
+ */
+struct pollfd;
+int poll (struct pollfd *fds, unsigned nfds, int timeout);
+
+/*
+ * Gets (F_GETFL) or sets (F_SETFL) the O_NONBLOCK and O_CLOEXEC flags of file descriptor fd.
+ */
+int fcntl (int fd, int cmd, int arg);
+
+/*
+ * Returns the lowest unused file descriptor, made to refer to what fd refers to, or -1 if fd is not open.
+ * A duplicated file has its own position.
+ */
+int dup (int fd);
+
+/*
+ * Makes newfd refer to what fd refers to, closing newfd first if it is open, and returns newfd.
+ * Returns -1 if fd is not open or newfd is negative.
+ */
+int dup2 (int fd, int newfd);
+
 #endif /* userprog/syscall.h */
 
@@ -0,0 +1,65 @@
+#include "userprog/systrace.h"
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Trace of completed system calls.
+
+   Every system call that returns is written into a fixed ring of
+   events, overwriting the oldest once the ring is full, and
+   SYS_TRACE drains it.  There is one ring because there is one
+   CPU: a writer only has to keep other threads out for the few
+   stores that fill in its slot, which it does by turning off
+   interrupts rather than taking a lock, so that tracing never
+   blocks and never shows up in the lock statistics itself.
+
+   HEAD and TAIL count events written and read since boot; the
+   slot of event N is N % TRACE_RING_SIZE.  A reader that falls
+   more than a ring behind skips ahead to the oldest event still
+   held, leaving a gap in the sequence numbers it sees. */
+
+/* Number of events held.  Must be a power of 2. */
+#define TRACE_RING_SIZE 512
+
+static struct syscall_event ring[TRACE_RING_SIZE];
+static unsigned head;           /* Events ever written. */
+static unsigned tail;           /* Events ever read or skipped. */
+
+/* Adds an event for system call NR, made with ARGS by the
+   running thread at time-stamp START, that returned RESULT
+   CYCLES later. */
+void
+systrace_record (int nr, const uint32_t args[3], int result,
+                 uint64_t start, uint64_t cycles)
+{
+  enum intr_level old_level = intr_disable ();
+  struct syscall_event *e = &ring[head % TRACE_RING_SIZE];
+
+  e->seq = head++;
+  e->tid = thread_tid ();
+  e->nr = nr;
+  e->args[0] = args[0];
+  e->args[1] = args[1];
+  e->args[2] = args[2];
+  e->result = result;
+  e->start = start;
+  e->cycles = cycles;
+  intr_set_level (old_level);
+}
+
+/* Moves up to MAX of the oldest events not yet read into EVENTS
+   and returns the number moved. */
+size_t
+systrace_drain (struct syscall_event *events, size_t max)
+{
+  enum intr_level old_level = intr_disable ();
+  size_t cnt;
+
+  if (head - tail > TRACE_RING_SIZE)
+    tail = head - TRACE_RING_SIZE;
+  for (cnt = 0; cnt < max && tail != head; cnt++)
+    events[cnt] = ring[tail++ % TRACE_RING_SIZE];
+  intr_set_level (old_level);
+
+  return cnt;
+}
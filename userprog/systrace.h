@@ -0,0 +1,12 @@
+#ifndef USERPROG_SYSTRACE_H
+#define USERPROG_SYSTRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <syscall-nr.h>
+
+void systrace_record (int nr, const uint32_t args[3], int result,
+                      uint64_t start, uint64_t cycles);
+size_t systrace_drain (struct syscall_event *, size_t max);
+
+#endif /* userprog/systrace.h */
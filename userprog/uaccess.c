@@ -0,0 +1,123 @@
+#include "userprog/uaccess.h"
+#include <stdint.h>
+#include "threads/vaddr.h"
+
+/* Each primitive below records, in the __ex_table section, the
+   address of the one instruction that touches user memory and of
+   a recovery label just after it.  If that instruction faults and
+   the fault cannot be resolved by lazy loading or stack growth,
+   page_fault() finds its address with uaccess_fixup() and resumes
+   execution at the label with EAX set to -1, so EAX ends up
+   telling the caller whether the access worked.  A kernel fault
+   at any other instruction is not recovered. */
+
+/* An entry in the exception table. */
+struct ex_entry
+  {
+    uintptr_t insn;             /* Instruction that may fault. */
+    uintptr_t fixup;            /* Where to resume if it does. */
+  };
+
+/* Exception table, gathered by the linker script. */
+extern const struct ex_entry _start_ex_table[], _end_ex_table[];
+
+/* Returns true if the SIZE bytes starting at UADDR lie entirely
+   in user virtual memory. */
+static bool
+user_range_ok (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  uintptr_t end = start + size;
+
+  return end >= start && end <= (uintptr_t) PHYS_BASE;
+}
+
+/* Copies SIZE bytes from SRC to DST, either of which may be a
+   user address.  Returns false if the copy faulted. */
+static bool
+fault_safe_copy (void *dst, const void *src, size_t size)
+{
+  int result;
+
+  asm volatile ("1:\trep movsb\n\t"
+                "xorl %%eax, %%eax\n"
+                "2:\n\t"
+                ".pushsection __ex_table, \"a\"\n\t"
+                ".long 1b, 2b\n\t"
+                ".popsection"
+                : "=&a" (result), "+D" (dst), "+S" (src), "+c" (size)
+                : : "memory");
+  return result == 0;
+}
+
+/* Reads a byte at user address UADDR, which must be below
+   PHYS_BASE.  Returns the byte value if successful, -1 if a fault
+   occurred. */
+static int
+get_user (const uint8_t *uaddr)
+{
+  int result;
+
+  asm volatile ("1:\tmovzbl %1, %0\n"
+                "2:\n\t"
+                ".pushsection __ex_table, \"a\"\n\t"
+                ".long 1b, 2b\n\t"
+                ".popsection"
+                : "=&a" (result) : "m" (*uaddr));
+  return result;
+}
+
+/* Returns the address at which to resume after a kernel fault at
+   EIP while accessing user memory, or 0 if EIP is not one of the
+   instructions in the exception table. */
+uintptr_t
+uaccess_fixup (uintptr_t eip) 
+{
+  const struct ex_entry *e;
+
+  for (e = _start_ex_table; e < _end_ex_table; e++)
+    if (e->insn == eip)
+      return e->fixup;
+  return 0;
+}
+
+/* Copies SIZE bytes from user address USRC to DST.  Returns
+   false if any of the source bytes could not be read, in which
+   case DST may have been partly written. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size) 
+{
+  return user_range_ok (usrc, size) && fault_safe_copy (dst, usrc, size);
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.  Returns false
+   if any of the destination bytes could not be written. */
+bool
+copy_to_user (void *udst, const void *src, size_t size) 
+{
+  return user_range_ok (udst, size) && fault_safe_copy (udst, src, size);
+}
+
+/* Copies the null-terminated string at user address USRC into
+   the SIZE-byte buffer DST, truncating it if necessary so that
+   DST is always null-terminated.  Returns false if the string
+   could not be read.  SIZE must be at least 1. */
+bool
+copy_string_from_user (char *dst, const char *usrc, size_t size) 
+{
+  const uint8_t *src = (const uint8_t *) usrc;
+  size_t i;
+
+  for (i = 0; i + 1 < size; i++) 
+    {
+      int c;
+
+      if (!is_user_vaddr (src + i) || (c = get_user (src + i)) == -1)
+        return false;
+      dst[i] = c;
+      if (c == '\0')
+        return true;
+    }
+  dst[i] = '\0';
+  return true;
+}
@@ -0,0 +1,18 @@
+#ifndef USERPROG_UACCESS_H
+#define USERPROG_UACCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Copying data between kernel and user memory.  These check only
+   that the user range lies below PHYS_BASE; whether the pages are
+   actually mapped is discovered by touching them, with
+   page_fault() turning an unresolvable fault into a false
+   return. */
+bool copy_from_user (void *dst, const void *usrc, size_t size);
+bool copy_to_user (void *udst, const void *src, size_t size);
+bool copy_string_from_user (char *dst, const char *usrc, size_t size);
+uintptr_t uaccess_fixup (uintptr_t eip);
+
+#endif /* userprog/uaccess.h */
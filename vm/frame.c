@@ -3,61 +3,87 @@
 #include "lib/kernel/list.h"
 #include "threads/palloc.h"
 #include "threads/malloc.h"
+#include "threads/stats.h"
 #include "threads/thread.h"
 #include "userprog/pagedir.h"
 #include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/pagecache.h"
 #include "vm/swap.h"
 
 /* 
- * Frame implementation for VM list or simple array?
+ * Frame table. Holds one entry for every user pool page that is
+ * currently backing a user page. Frames are taken from the user
+ * pool when a page is mapped and given back when their owner
+ * exits or the kernel needs memory, so the table only ever holds
+ * as many entries as there are resident user pages.
+ *
+ * Frames that are pinned (see frame_pin) sit on pinned_list
+ * instead of frame_list, so eviction never has to look at them.
  */
-struct frame_table_entry *frame_table;
+static struct list frame_list;
+static struct list pinned_list;
 struct lock frame_lock;
 
+static struct frame_table_entry *frame_choose_victim(tid_t avoid_tid);
+static void frame_release(struct frame_table_entry *fte);
+static void pin_locked(struct frame_table_entry *fte);
+
+/*
+ * Initializes the frame table. Entries are created only as
+ * frame_get() hands out frames, so boot does not touch the user
+ * pool at all.
+ */
 void
 frame_table_init (void)
 {
-  int user_pages = palloc_get_num_user_pages ();
-  frame_table = (struct frame_table_entry *)(malloc(sizeof(struct frame_table_entry) * user_pages));
-
-  void *frame_ptr;
-  int i = 0;
-  for (i = 0; i < palloc_get_num_user_pages(); i++)
-    {
-      frame_ptr = palloc_get_page(PAL_USER);
-      frame_table[i].frame_addr = frame_ptr; 
-      frame_table[i].owner_tid = -1;
-      frame_table[i].spte = NULL;
-			frame_table[i].in_edit = false;
-    }
-
+  list_init (&frame_list);
+  list_init (&pinned_list);
   lock_init (&frame_lock);
+  lock_set_name (&frame_lock, "frame");
+  palloc_set_shrinker (frame_shrink);
 }
 
 /*
- * Goes through the frame table to find a frame that's available.
- * Does that by checking if owner == -1. If all frames are owned,
- * then call frame_evict to get a free frame.
+ * Takes a fresh page from the user pool for the current thread.
+ * If the user pool is empty, unused page cache frames are given
+ * back to it first. If that doesn't help (or the entry itself
+ * can't be allocated), call frame_evict to free up a frame that
+ * is in use.
+ * The frame is returned pinned, so it can't be evicted while it is
+ * being filled in; the caller unpins it when done.
+ * Must be called with frame_lock held.
  */
 struct frame_table_entry *
 frame_get()
 {
-  int i;
-  for (i = 0; i < palloc_get_num_user_pages(); i++)
+  struct frame_table_entry *fte;
+  void *frame_ptr = palloc_get_page (PAL_USER);
+
+  while (frame_ptr == NULL && page_cache_shrink ())
+    {
+      frame_ptr = palloc_get_page (PAL_USER);
+    }
+  if (frame_ptr != NULL)
     {
-      if (frame_table[i].owner_tid == -1)
+      fte = malloc (sizeof *fte);
+      if (fte != NULL)
         {
-					frame_table[i].spte = NULL;
-          frame_table[i].owner_tid = thread_current()->tid;
-					frame_table[i].in_edit = true;
-          return &frame_table[i];
+          fte->frame_addr = frame_ptr;
+          fte->owner_tid = thread_current()->tid;
+          fte->spte = NULL;
+          fte->pin_cnt = 1;
+          list_push_back (&pinned_list, &fte->elem);
+          return fte;
         }
+      palloc_free_page (frame_ptr);
     }
-  
+
   struct frame_table_entry *efte = frame_evict();
 	efte->spte = NULL;
-	efte->in_edit = true;
+	efte->pin_cnt = 1;
+  list_remove (&efte->elem);
+  list_push_back (&pinned_list, &efte->elem);
   return efte;
 }
 
@@ -75,6 +101,7 @@ frame_map(struct sup_pte *spte)
   lock_release(&frame_lock);
 
   fte->spte = spte;
+  spte->fte = fte;
 
 
   bool success = (pagedir_get_page (t->pagedir, spte->user_vaddr) == NULL
@@ -89,27 +116,35 @@ frame_map(struct sup_pte *spte)
     {
       // deallocate frame
 			spte->valid = false;
-      fte->owner_tid = -1;
-			fte->spte = NULL;
+      spte->fte = NULL;
+      lock_acquire (&frame_lock);
+      frame_release (fte);
+      lock_release (&frame_lock);
       return NULL;
     }
 }
 
 /*
- * Marks the frames owned by owner to be unowned and free.
+ * Gives the frames owned by owner back to the user pool.
  */
 void 
 frame_table_clear(struct thread *owner)
 {
-  
-  lock_acquire (&frame_lock);
+  struct list *lists[] = {&frame_list, &pinned_list};
+  struct list_elem *e, *next;
   int i;
-  for (i = 0; i < palloc_get_num_user_pages(); i++)
+
+  lock_acquire (&frame_lock);
+  for (i = 0; i < 2; i++)
     {
-      if (frame_table[i].owner_tid == owner->tid)
+      for (e = list_begin (lists[i]); e != list_end (lists[i]); e = next)
         {
-          frame_table[i].owner_tid = -1;
-					frame_table[i].spte = NULL;
+          struct frame_table_entry *fte = list_entry (e, struct frame_table_entry, elem);
+          next = list_next (e);
+          if (fte->owner_tid == owner->tid)
+            {
+              frame_release (fte);
+            }
         }
     }
   lock_release(&frame_lock);
@@ -121,13 +156,132 @@ frame_table_clear(struct thread *owner)
 void
 frame_table_destroy()
 {
-  //lock_release(&frame_lock);
-  int i;
-  for (i = 0; i < palloc_get_num_user_pages(); i++)
+  lock_acquire (&frame_lock);
+  while (!list_empty (&frame_list))
+    {
+      frame_release (list_entry (list_front (&frame_list),
+                                 struct frame_table_entry, elem));
+    }
+  while (!list_empty (&pinned_list))
     {
-      palloc_free_page (frame_table[i].frame_addr);
+      frame_release (list_entry (list_front (&pinned_list),
+                                 struct frame_table_entry, elem));
     }
-  //lock_release(&frame_lock);
+  lock_release (&frame_lock);
+}
+
+/*
+ * Pins fte so that it can't be evicted until a matching
+ * frame_unpin(). Pins nest.
+ */
+void
+frame_pin (struct frame_table_entry *fte)
+{
+  lock_acquire (&frame_lock);
+  pin_locked (fte);
+  lock_release (&frame_lock);
+}
+
+/*
+ * Pins the frame holding spte's page, if the page is resident.
+ * Returns false without pinning anything if it isn't. Checking
+ * and pinning under frame_lock means the page can't be evicted
+ * in between.
+ */
+bool
+frame_pin_spte (struct sup_pte *spte)
+{
+  bool pinned = false;
+
+  lock_acquire (&frame_lock);
+  if (spte->valid && spte->fte != NULL)
+    {
+      pin_locked (spte->fte);
+      pinned = true;
+    }
+  lock_release (&frame_lock);
+
+  return pinned;
+}
+
+/*
+ * Pins fte, moving it off the eviction list if this is its first
+ * pin. Must be called with frame_lock held.
+ */
+static void
+pin_locked (struct frame_table_entry *fte)
+{
+  if (fte->pin_cnt++ == 0)
+    {
+      list_remove (&fte->elem);
+      list_push_back (&pinned_list, &fte->elem);
+    }
+}
+
+/*
+ * Drops one pin on fte. Once the last pin is gone the frame
+ * becomes a candidate for eviction again, behind every frame
+ * that was already one.
+ */
+void
+frame_unpin (struct frame_table_entry *fte)
+{
+  lock_acquire (&frame_lock);
+  ASSERT (fte->pin_cnt > 0);
+  if (--fte->pin_cnt == 0)
+    {
+      list_remove (&fte->elem);
+      list_push_back (&frame_list, &fte->elem);
+    }
+  lock_release (&frame_lock);
+}
+
+/*
+ * Shrinker registered with the page allocator. Gives an unused
+ * page cache frame back to the user pool, or failing that swaps
+ * out one resident user page and returns its frame, so that a
+ * kernel allocation can be retried. Returns false if
+ * nothing could be reclaimed, including when the caller is
+ * already inside the frame table or the swap code, since
+ * evicting from there would deadlock on their locks.
+ */
+bool
+frame_shrink (void)
+{
+  struct frame_table_entry *fte;
+
+  if (page_cache_shrink ())
+    {
+      return true;
+    }
+  if (lock_held_by_current_thread (&frame_lock)
+      || lock_held_by_current_thread (&swap_lock))
+    {
+      return false;
+    }
+
+  lock_acquire (&frame_lock);
+  fte = frame_choose_victim (TID_ERROR);
+  if (fte != NULL)
+    {
+      frame_swap (fte);
+      frame_release (fte);
+    }
+  lock_release (&frame_lock);
+
+  return fte != NULL;
+}
+
+/*
+ * Removes fte from the frame table and frees its page and the
+ * entry itself. Must be called with frame_lock held.
+ */
+static void
+frame_release (struct frame_table_entry *fte)
+{
+  list_remove (&fte->elem);
+  palloc_free_page (fte->frame_addr);
+  free (fte);
 }
 
 /*
@@ -152,6 +306,7 @@ frame_swap(struct frame_table_entry *fte)
     }
 
   evicted_spte->valid = false;
+  evicted_spte->fte = NULL;
   fte->owner_tid = thread_current()->tid;
 
 	return fte;
@@ -159,10 +314,9 @@ frame_swap(struct frame_table_entry *fte)
 
 /*
  * Evicts a frame and makes it available.
- * Finds the first frame that is not owned by the current thread.
- * If all frames are owned by current thread, pick any frame
- * that isn't the stack.
- * All else, pick the 51st frame. 
+ * Prefers a frame that is not owned by the current thread,
+ * then any frame at all, never picking a stack page while another
+ * choice exists. Pinned frames are never picked.
  *
  * Once a frame is chosen to be evicted, call frame_swap() to send that
  * frame to the swap disk (The frame is zeroed out by swap_to_disk()).
@@ -170,30 +324,44 @@ frame_swap(struct frame_table_entry *fte)
 struct frame_table_entry *
 frame_evict()
 {
-	tid_t current_tid = thread_current()->tid;
+  struct frame_table_entry *fte;
 
-  // Iterate over frames looking for one that is not owned by current thread
-  int i;
-  for (i = 0; i < palloc_get_num_user_pages(); i++)
+  fte = frame_choose_victim (thread_current()->tid);
+  if (fte == NULL)
     {
-      if (frame_table[i].owner_tid != current_tid 
-					&& !frame_table[i].spte->is_stack && !frame_table[i].in_edit)
-        {
-          return frame_swap(&frame_table[i]);
-        }
+      PANIC ("No frame can be evicted\n");
     }
+  stat_inc (STAT_EVICTIONS);
+  return frame_swap (fte);
+}
+
+/*
+ * Picks a frame to evict: the first unpinned one not owned by
+ * avoid_tid and not holding a stack page, or failing that the
+ * last unpinned non-stack frame, or failing that any unpinned
+ * frame. Returns NULL if every frame is pinned.
+ */
+static struct frame_table_entry *
+frame_choose_victim (tid_t avoid_tid)
+{
+  struct frame_table_entry *fallback = NULL;
+  struct list_elem *e;
 
-  // If we got here, every frame is owned by the current thread
-  for(i = palloc_get_num_user_pages() -1; i > 0; --i)
+  for (e = list_begin (&frame_list); e != list_end (&frame_list);
+       e = list_next (e))
     {
-      if(!frame_table[i].spte->is_stack && !frame_table[i].in_edit)
+      struct frame_table_entry *fte = list_entry (e, struct frame_table_entry, elem);
+      if (!fte->spte->is_stack && fte->owner_tid != avoid_tid)
+        {
+          return fte;
+        }
+      if (fallback == NULL || !fte->spte->is_stack)
         {
-          return frame_swap(&frame_table[i]);
+          fallback = fte;
         }
     }
 
-  // SHOULD NEVER BE CALLED
-  return frame_swap(&frame_table[50]);
+  return fallback;
 }
   
 void 
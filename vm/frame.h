@@ -12,7 +12,8 @@ struct frame_table_entry {
 	tid_t owner_tid;
 	struct sup_pte *spte;
 	void *frame_addr;
-	bool in_edit;
+	int pin_cnt;                /* Times pinned; never evicted while > 0. */
+	struct list_elem elem;      /* Element in frame_list or pinned_list. */
 };
 
 void frame_table_init(void);
@@ -21,6 +22,11 @@ struct frame_table_entry *frame_get(void);
 struct frame_table_entry *frame_map(struct sup_pte *spte);
 void frame_table_clear(struct thread *owner);
 void frame_table_destroy(void);
+bool frame_shrink(void);
+
+void frame_pin(struct frame_table_entry *fte);
+bool frame_pin_spte(struct sup_pte *spte);
+void frame_unpin(struct frame_table_entry *fte);
 
 struct frame_table_entry * frame_swap(struct frame_table_entry *fte);
 struct frame_table_entry *frame_evict(void);    
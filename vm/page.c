@@ -12,11 +12,33 @@
 #include "userprog/syscall.h"
 #include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/pagecache.h"
 #include "vm/swap.h"
 
 void spte_insert (struct list *sup_pt, struct sup_pte *pte);
 bool in_same_page(uint8_t *vaddr1, uint8_t *vaddr2);
 
+/* Most pages spt_clear() unmaps with one TLB invalidation. */
+#define SPT_CLEAR_BATCH 64
+
+/* Cache that all SPTEs are allocated from. */
+static struct obj_cache *spte_cache;
+
+/*
+ * Sets up the allocator for SPT entries. Must be called once
+ * before any process is started.
+ */
+void
+vm_page_init (void)
+{
+  spte_cache = obj_cache_create ("sup_pte", sizeof (struct sup_pte), NULL);
+  if (spte_cache == NULL)
+    {
+      PANIC ("Could not create SPTE cache\n");
+    }
+  page_cache_init ();
+}
+
 /*
  * Initializes the supplemental page table (SPT).
  */
@@ -58,48 +80,58 @@ in_same_page(uint8_t *vaddr1, uint8_t *vaddr2)
 
 /*
  * Clear SPT by uninstalling valid pages and freeing all swap table entries.
- * Free SPTEs as we go through the SPT list.
- * Free all frames that are owned by current thread.
+ * Mappings are cleared first, so that no frame goes back to the user pool
+ * while the owner's page directory still maps it. The frames owned by the
+ * thread are freed next, and only then the swap slots and SPTEs, so the
+ * evictor can't pick one of owner's frames whose SPTE is already gone.
  */
 void
 spt_clear(struct thread *owner)
 {
   if (list_empty (&owner->spt) )
       {
+        frame_table_clear(owner);
         return;
       }
 
-  struct list_elem *e, *prev = NULL;
+  /* Resident private pages are unmapped in batches, so that the
+     TLB is flushed once per batch rather than once per page. */
+  void *batch[SPT_CLEAR_BATCH];
+  size_t batch_cnt = 0;
+
+  struct list_elem *e;
   for (e = list_begin(&owner->spt); e != list_end(&owner->spt);
        e = list_next(e))
     {
-      if (prev != NULL)
-        {
-          list_remove(prev);
-          struct sup_pte *prev_spte = list_entry(prev, struct sup_pte, elem);
-          free (prev_spte);
-        }
-
       struct sup_pte *spte = list_entry(e, struct sup_pte, elem);
-      if (pagedir_get_page (owner->pagedir, spte->user_vaddr))
+      if (spte->shared != NULL)
         {
-					pagedir_clear_page(owner->pagedir, spte->user_vaddr);
+          page_cache_unmap (owner, spte);
         }
-      else if (spte->in_swap)
+      else if (pagedir_get_page (owner->pagedir, spte->user_vaddr))
         {
-          swap_clear(spte->swap_table_index);
+          batch[batch_cnt++] = spte->user_vaddr;
+          if (batch_cnt == SPT_CLEAR_BATCH)
+            {
+              pagedir_clear_pages (owner->pagedir, batch, batch_cnt);
+              batch_cnt = 0;
+            }
         }
-
-      prev = e;
-    }
-  if (prev != NULL)
-    {
-      list_remove(prev);
-      struct sup_pte *prev_spte = list_entry(prev, struct sup_pte, elem);
-      free (prev_spte);
     }
+  pagedir_clear_pages (owner->pagedir, batch, batch_cnt);
 
   frame_table_clear(owner);
+
+  while (!list_empty (&owner->spt))
+    {
+      struct sup_pte *spte = list_entry(list_pop_front(&owner->spt),
+                                        struct sup_pte, elem);
+      if (spte->in_swap)
+        {
+          swap_clear(spte->swap_table_index);
+        }
+      obj_cache_free (spte_cache, spte);
+    }
 }
 
 void
@@ -133,7 +165,7 @@ alloc_code_spte(struct file *file, off_t ofs, uint8_t *upage,
 #endif
   ASSERT (read_bytes + zero_bytes == PGSIZE);
 
-  struct sup_pte *new_spte = (struct sup_pte *) malloc (sizeof(struct sup_pte));
+  struct sup_pte *new_spte = obj_cache_alloc (spte_cache);
   if (new_spte == NULL)
     {
       return false;
@@ -155,6 +187,8 @@ alloc_code_spte(struct file *file, off_t ofs, uint8_t *upage,
   new_spte->zero_bytes = zero_bytes;
   new_spte->writable = writable;
   new_spte->has_been_loaded = false;
+  new_spte->fte = NULL;
+  new_spte->shared = NULL;
 
   spte_insert(&thread_current()->spt, new_spte); 
 
@@ -171,7 +205,7 @@ alloc_code_spte(struct file *file, off_t ofs, uint8_t *upage,
 bool
 alloc_blank_spte(uint8_t *upage)
 {
-  struct sup_pte *new_spte = (struct sup_pte *) malloc (sizeof(struct sup_pte));
+  struct sup_pte *new_spte = obj_cache_alloc (spte_cache);
   if (new_spte == NULL)
     {
       return false;
@@ -191,6 +225,8 @@ alloc_blank_spte(uint8_t *upage)
   new_spte->offset = 0;
   new_spte->read_bytes = 0;
   new_spte->zero_bytes = 0;
+  new_spte->fte = NULL;
+  new_spte->shared = NULL;
 
   spte_insert(&thread_current()->spt, new_spte); 
 
@@ -202,7 +238,7 @@ alloc_blank_spte(uint8_t *upage)
 
   memset(fte->frame_addr, 0, PGSIZE);
   new_spte->valid = true;
-  fte->in_edit = false;
+  frame_unpin (fte);
 
   return true;
 }
@@ -210,11 +246,19 @@ alloc_blank_spte(uint8_t *upage)
 /*
  * Loads an SPTE by mapping it to a physical frame.
  * Determines whether it should load from swap
- * or read from a file.
+ * or read from a file. Read-only file pages are mapped from the
+ * page cache, shared with any other process running the same
+ * program, unless the cache can't supply a frame.
  */
 bool 
 load_spte (struct sup_pte *spte)
 {
+  if (spte->is_file && !spte->writable && !spte->in_swap
+      && page_cache_map (spte))
+    {
+      return true;
+    }
+
   struct frame_table_entry *fte = frame_map(spte);
   if (fte == NULL)
     {
@@ -243,14 +287,122 @@ load_spte (struct sup_pte *spte)
       spte->has_been_loaded = true;
     }
 
-  if (fte)
+  spte->valid = true;
+  frame_unpin (fte);
+  return true;
+}
+
+/*
+ * Makes the page containing uaddr resident and pins its frame.
+ * Grows the stack if the page doesn't exist yet but would be
+ * a stack page being written.
+ * Returns false if the page can't be used that way.
+ */
+static bool
+page_pin (const uint8_t *uaddr, bool write)
+{
+  struct sup_pte *spte = get_spte((uint8_t *) uaddr);
+  if (spte == NULL)
+    {
+      if (!write || (unsigned int) uaddr <= HEAP_STACK_DIVIDE
+          || !alloc_blank_spte((uint8_t *) uaddr))
+        {
+          return false;
+        }
+      spte = get_spte((uint8_t *) uaddr);
+    }
+  if (write && !spte->writable)
     {
-      fte->in_edit = false;
+      return false;
+    }
+
+  /* The page may be evicted again between loading and pinning,
+     so keep trying until the pin catches it resident. Shared
+     pages are never evicted while mapped, so they need no pin. */
+  while (spte->shared == NULL && !frame_pin_spte (spte))
+    {
+      if (!load_spte (spte))
+        {
+          return false;
+        }
     }
-  spte->valid = true;
   return true;
 }
 
+/*
+ * Unpins the frame holding the page containing uaddr, which must
+ * have been pinned with page_pin().
+ */
+static void
+page_unpin (const uint8_t *uaddr)
+{
+  struct sup_pte *spte = get_spte((uint8_t *) uaddr);
+  ASSERT (spte != NULL);
+  if (spte->shared != NULL)
+    {
+      return;
+    }
+  ASSERT (spte->fte != NULL);
+  frame_unpin (spte->fte);
+}
+
+/*
+ * Pins every page of the user buffer of size bytes at uaddr so it
+ * can't be evicted while the kernel reads or writes it directly,
+ * loading pages as needed. If write is true, the pages must be
+ * writable. Returns false, with nothing left pinned, if part of
+ * the buffer isn't valid user memory.
+ */
+bool
+page_pin_range (const void *uaddr, size_t size, bool write)
+{
+  const uint8_t *start = pg_round_down (uaddr);
+  const uint8_t *end = (const uint8_t *) uaddr + size;
+  const uint8_t *page;
+
+  if (size == 0)
+    {
+      return true;
+    }
+  if (end < (const uint8_t *) uaddr || (const void *) end > PHYS_BASE)
+    {
+      return false;
+    }
+
+  for (page = start; page < end; page += PGSIZE)
+    {
+      if (!page_pin (page, write))
+        {
+          while (page > start)
+            {
+              page -= PGSIZE;
+              page_unpin (page);
+            }
+          return false;
+        }
+    }
+  return true;
+}
+
+/*
+ * Undoes page_pin_range() for the same buffer.
+ */
+void
+page_unpin_range (const void *uaddr, size_t size)
+{
+  const uint8_t *end = (const uint8_t *) uaddr + size;
+  const uint8_t *page;
+
+  if (size == 0)
+    {
+      return;
+    }
+  for (page = pg_round_down (uaddr); page < end; page += PGSIZE)
+    {
+      page_unpin (page);
+    }
+}
+
 void
 print_spte(struct sup_pte *pte)
 {
@@ -2,6 +2,7 @@
 #define VM_PAGE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <inttypes.h>
 #include "kernel/list.h"
 #include "filesys/off_t.h"
@@ -41,11 +42,18 @@ struct sup_pte
   int zero_bytes;
   bool has_been_loaded;
 
+  /* frame holding the page while valid, else NULL */
+  struct frame_table_entry *fte;
+
+  /* page cache entry while valid and shared, else NULL */
+  struct cached_page *shared;
+
   struct list_elem elem;
 };
 
 
 /* Core functions */
+void vm_page_init(void);
 void vm_page_table_init(struct list *spt);
 struct sup_pte * get_spte(uint8_t *fault_addr);
 void spt_clear(struct thread *owner);
@@ -56,6 +64,10 @@ bool alloc_code_spte(struct file *file, off_t ofs, uint8_t *upage,
 bool alloc_blank_spte(uint8_t *upage);
 bool load_spte (struct sup_pte *spte);
 
+/* Keeping user buffers resident during I/O */
+bool page_pin_range (const void *uaddr, size_t size, bool write);
+void page_unpin_range (const void *uaddr, size_t size);
+
 /* Debugging functions */
 void print_all_spte(void);
 void print_spte(struct sup_pte *pte);
@@ -0,0 +1,372 @@
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "vm/pagecache.h"
+
+/*
+ * Page cache. Read-only pages of executables are identical in
+ * every process running the same binary, so instead of giving
+ * each process a private frame, a page is read once into a frame
+ * of its own and mapped read-only into every process that needs
+ * it. Pages are found by the sector of their file's inode, the
+ * offset of the page in the file, and the number of bytes read
+ * from the file into the page.
+ *
+ * A shared frame is never evicted while it is mapped. Once its
+ * last mapping goes, it moves to unused_list and stays cached, so
+ * that running the same program again finds its text already in
+ * memory. Unused frames are given back to the user pool, oldest
+ * first, by page_cache_shrink(), which the frame table calls
+ * before it resorts to eviction.
+ *
+ * Writing to or deleting a file drops its pages from the cache
+ * (see page_cache_invalidate()). Pages still mapped when that
+ * happens stay mapped until their processes exit; executables
+ * can't be written while they run anyway.
+ *
+ * cache_lock is never held while reading a file, calling into
+ * the frame table, or allocating memory that could reach the
+ * shrinker, so it can be taken under file_lock and frame_lock.
+ */
+
+/* Number of buckets in the table of cached files. */
+#define FILE_BUCKET_CNT 64
+
+/* Every cached page of one file. */
+struct cached_file
+  {
+    struct list_elem elem;      /* Element in a file bucket. */
+    block_sector_t sector;      /* Sector of the file's inode. */
+    struct list pages;          /* List of struct cached_page. */
+  };
+
+/* One cached page. */
+struct cached_page
+  {
+    struct list_elem file_elem; /* Element in its file's pages. */
+    struct list_elem lru_elem;  /* Element in unused_list. */
+    struct cached_file *file;   /* File it belongs to, or NULL if stale. */
+    off_t offset;               /* Offset of the page in the file. */
+    int read_bytes;             /* Bytes read from the file. */
+    void *kpage;                /* Frame, from the user pool. */
+    int map_cnt;                /* Number of processes mapping it. */
+  };
+
+/* Cached files, hashed by inode sector.  The table has a fixed
+   size so that inserting never allocates memory. */
+static struct list file_buckets[FILE_BUCKET_CNT];
+static struct list unused_list;
+static struct lock cache_lock;
+
+static struct cached_file *file_lookup (block_sector_t sector);
+static struct cached_page *page_lookup (block_sector_t sector, off_t offset,
+                                        int read_bytes);
+static void page_insert (struct cached_page *page, block_sector_t sector,
+                         struct cached_file **new_file);
+static void page_free (struct cached_page *page);
+
+/*
+ * Initializes the page cache. Must be called once before any
+ * process is started.
+ */
+void
+page_cache_init (void)
+{
+  int i;
+
+  for (i = 0; i < FILE_BUCKET_CNT; i++)
+    {
+      list_init (&file_buckets[i]);
+    }
+  list_init (&unused_list);
+  lock_init (&cache_lock);
+  lock_set_name (&cache_lock, "pagecache");
+}
+
+/*
+ * Maps spte, which must be a read-only file page that is not
+ * resident, to a shared frame holding its contents, reading the
+ * page into a new frame if it isn't cached yet. Returns false if
+ * no frame or memory is available, in which case the caller
+ * should load the page privately instead.
+ */
+bool
+page_cache_map (struct sup_pte *spte)
+{
+  block_sector_t sector = inode_get_inumber (file_get_inode (spte->file));
+  struct thread *t = thread_current ();
+  struct cached_page *page, *new_page = NULL;
+  struct cached_file *new_file = NULL;
+
+  ASSERT (spte->is_file && !spte->writable && !spte->in_swap);
+
+  lock_acquire (&cache_lock);
+  page = page_lookup (sector, spte->offset, spte->read_bytes);
+  if (page != NULL && page->map_cnt++ == 0)
+    {
+      list_remove (&page->lru_elem);
+    }
+  lock_release (&cache_lock);
+
+  if (page == NULL)
+    {
+      /* Read the page without cache_lock held, then insert it
+         unless someone else got there first.  The file's entry is
+         allocated up front in case the file isn't cached yet. */
+      new_page = malloc (sizeof *new_page);
+      new_file = malloc (sizeof *new_file);
+      if (new_page != NULL)
+        {
+          new_page->kpage = palloc_get_page (PAL_USER);
+        }
+      if (new_page == NULL || new_file == NULL || new_page->kpage == NULL)
+        {
+          if (new_page != NULL && new_page->kpage != NULL)
+            {
+              palloc_free_page (new_page->kpage);
+            }
+          free (new_page);
+          free (new_file);
+          return false;
+        }
+      new_page->offset = spte->offset;
+      new_page->read_bytes = spte->read_bytes;
+      new_page->map_cnt = 1;
+
+      lock_acquire (&file_lock);
+      if (file_read_at (spte->file, new_page->kpage, spte->read_bytes,
+                        spte->offset) != spte->read_bytes)
+        {
+          PANIC ("File or code could not be read properly.\n");
+        }
+      lock_release (&file_lock);
+      memset ((uint8_t *) new_page->kpage + spte->read_bytes, 0,
+              PGSIZE - spte->read_bytes);
+
+      lock_acquire (&cache_lock);
+      page = page_lookup (sector, spte->offset, spte->read_bytes);
+      if (page != NULL)
+        {
+          if (page->map_cnt++ == 0)
+            {
+              list_remove (&page->lru_elem);
+            }
+        }
+      else
+        {
+          page_insert (new_page, sector, &new_file);
+          page = new_page;
+          new_page = NULL;
+        }
+      lock_release (&cache_lock);
+
+      if (new_page != NULL)
+        {
+          page_free (new_page);
+        }
+      free (new_file);
+    }
+
+  if (pagedir_get_page (t->pagedir, spte->user_vaddr) != NULL
+      || !pagedir_set_page (t->pagedir, spte->user_vaddr, page->kpage, false))
+    {
+      spte->shared = page;
+      page_cache_unmap (t, spte);
+      return false;
+    }
+
+  spte->shared = page;
+  spte->has_been_loaded = true;
+  spte->valid = true;
+  return true;
+}
+
+/*
+ * Unmaps spte's shared frame from owner's page directory and drops
+ * owner's reference to it.
+ */
+void
+page_cache_unmap (struct thread *owner, struct sup_pte *spte)
+{
+  struct cached_page *page = spte->shared;
+
+  ASSERT (page != NULL);
+
+  if (pagedir_get_page (owner->pagedir, spte->user_vaddr) == page->kpage)
+    {
+      pagedir_clear_page (owner->pagedir, spte->user_vaddr);
+    }
+  spte->shared = NULL;
+  spte->valid = false;
+
+  lock_acquire (&cache_lock);
+  ASSERT (page->map_cnt > 0);
+  if (--page->map_cnt == 0)
+    {
+      if (page->file == NULL)
+        {
+          page_free (page);
+        }
+      else
+        {
+          list_push_back (&unused_list, &page->lru_elem);
+        }
+    }
+  lock_release (&cache_lock);
+}
+
+/*
+ * Drops every cached page of the file whose inode is at sector,
+ * because the file is being written or its sectors freed. Must be
+ * called before the file's contents change.
+ */
+void
+page_cache_invalidate (block_sector_t inode_sector)
+{
+  struct cached_file *file;
+
+  lock_acquire (&cache_lock);
+  file = file_lookup (inode_sector);
+  if (file != NULL)
+    {
+      list_remove (&file->elem);
+      while (!list_empty (&file->pages))
+        {
+          struct cached_page *page = list_entry (list_pop_front (&file->pages),
+                                                 struct cached_page, file_elem);
+          page->file = NULL;
+          if (page->map_cnt == 0)
+            {
+              list_remove (&page->lru_elem);
+              page_free (page);
+            }
+        }
+      free (file);
+    }
+  lock_release (&cache_lock);
+}
+
+/*
+ * Gives the least recently unmapped unused frame back to the user
+ * pool. Returns false if there was none, or if the caller already
+ * holds cache_lock.
+ */
+bool
+page_cache_shrink (void)
+{
+  struct cached_page *page = NULL;
+
+  if (lock_held_by_current_thread (&cache_lock))
+    {
+      return false;
+    }
+
+  lock_acquire (&cache_lock);
+  if (!list_empty (&unused_list))
+    {
+      page = list_entry (list_pop_front (&unused_list),
+                         struct cached_page, lru_elem);
+      list_remove (&page->file_elem);
+      if (list_empty (&page->file->pages))
+        {
+          list_remove (&page->file->elem);
+          free (page->file);
+        }
+      page_free (page);
+    }
+  lock_release (&cache_lock);
+
+  return page != NULL;
+}
+
+/*
+ * Returns the cached file whose inode is at sector, or NULL.
+ * Must be called with cache_lock held.
+ */
+static struct cached_file *
+file_lookup (block_sector_t sector)
+{
+  struct list *bucket = &file_buckets[hash_int (sector) % FILE_BUCKET_CNT];
+  struct list_elem *e;
+
+  for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e))
+    {
+      struct cached_file *file = list_entry (e, struct cached_file, elem);
+      if (file->sector == sector)
+        {
+          return file;
+        }
+    }
+  return NULL;
+}
+
+/*
+ * Returns the cached page at offset in the file whose inode is at
+ * sector, holding read_bytes bytes of the file, or NULL.
+ * Must be called with cache_lock held.
+ */
+static struct cached_page *
+page_lookup (block_sector_t sector, off_t offset, int read_bytes)
+{
+  struct cached_file *file = file_lookup (sector);
+  struct list_elem *e;
+
+  if (file == NULL)
+    {
+      return NULL;
+    }
+  for (e = list_begin (&file->pages); e != list_end (&file->pages);
+       e = list_next (e))
+    {
+      struct cached_page *page = list_entry (e, struct cached_page, file_elem);
+      if (page->offset == offset && page->read_bytes == read_bytes)
+        {
+          return page;
+        }
+    }
+  return NULL;
+}
+
+/*
+ * Adds page to the cache as a page of the file whose inode is at
+ * sector. If the file isn't cached yet, takes *new_file for its
+ * entry and sets *new_file to NULL. Must be called with cache_lock
+ * held.
+ */
+static void
+page_insert (struct cached_page *page, block_sector_t sector,
+             struct cached_file **new_file)
+{
+  struct cached_file *file = file_lookup (sector);
+
+  if (file == NULL)
+    {
+      file = *new_file;
+      *new_file = NULL;
+      file->sector = sector;
+      list_init (&file->pages);
+      list_push_back (&file_buckets[hash_int (sector) % FILE_BUCKET_CNT],
+                      &file->elem);
+    }
+  page->file = file;
+  list_push_back (&file->pages, &page->file_elem);
+}
+
+/*
+ * Frees page and its frame.
+ */
+static void
+page_free (struct cached_page *page)
+{
+  palloc_free_page (page->kpage);
+  free (page);
+}
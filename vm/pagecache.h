@@ -0,0 +1,21 @@
+#ifndef VM_PAGECACHE_H
+#define VM_PAGECACHE_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+#include "threads/thread.h"
+#include "vm/page.h"
+
+/*
+ * Cache of read-only file pages shared between processes. Every
+ * process that maps the same page of the same executable maps the
+ * same frame, which stays cached after the last of them exits
+ * until the frame is needed for something else.
+ */
+void page_cache_init (void);
+bool page_cache_map (struct sup_pte *spte);
+void page_cache_unmap (struct thread *owner, struct sup_pte *spte);
+void page_cache_invalidate (block_sector_t inode_sector);
+bool page_cache_shrink (void);
+
+#endif
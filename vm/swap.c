@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "devices/block.h"
+#include "threads/stats.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "userprog/syscall.h"
@@ -30,6 +31,7 @@ swap_table_init(void)
   bitmap_set_all(swap_table, false);
 
   lock_init (&swap_lock);
+  lock_set_name (&swap_lock, "swap");
 }
 
 /*
@@ -72,6 +74,7 @@ swap_to_disk (struct frame_table_entry *fte)
   /* Clears the evicted frame in memory */
 	memset(fte->frame_addr, 0, PGSIZE);
   lock_release (&swap_lock);
+  stat_inc (STAT_SWAP_OUTS);
 
   return free_idx;
 }
@@ -108,6 +111,7 @@ swap_from_disk (struct frame_table_entry *dest_fte, int swap_idx)
 
   /* Indicate in the swap table that the sectors just read are now unused */
   bitmap_set(swap_table, swap_idx, false);
+  stat_inc (STAT_SWAP_INS);
   lock_release (&swap_lock);
 
   return true;